@@ -0,0 +1,161 @@
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include <bits/arena.hpp>
+#include <bits/pages.hpp>
+
+namespace bits {
+namespace {
+
+constexpr std::size_t kMinNoise = 16;
+constexpr std::size_t kMaxNoise = 256;
+
+// One cache line per node.
+struct Node {
+  Node* next = nullptr;
+  std::uint64_t value = 0;
+  std::array<char, 48> payload;
+};
+
+static_assert(sizeof(Node) == 64, "Node has bad size.");
+
+class New {
+ public:
+  Node* create() { return new Node{}; }
+
+  void clear(Node* head) {
+    while (head) {
+      auto next = head->next;
+      delete head;
+      head = next;
+    }
+  }
+};
+
+// Interleaves every node with an allocation of a random size which stays alive
+// as long as the list. This mimics a long running process where objects
+// allocated together by one request are scattered across the heap by
+// allocations (and frees) of everything else.
+class FragmentedNew : public New {
+ public:
+  Node* create() {
+    noise_.emplace_back(new char[sizes_(rng_)]);
+    return New::create();
+  }
+
+  void clear(Node* head) {
+    New::clear(head);
+    noise_.clear();
+  }
+
+ private:
+  std::mt19937 rng_{0};
+  std::uniform_int_distribution<std::size_t> sizes_{kMinNoise, kMaxNoise};
+  std::vector<std::unique_ptr<char[]>> noise_;
+};
+
+template <PageBacking B>
+class ArenaNew {
+ public:
+  Node* create() { return arena_.create<Node>(); }
+
+  void clear(Node*) { arena_.reset(); }
+
+ private:
+  Arena arena_{Arena::kDefaultBlockSize, B};
+};
+
+template <typename S>
+Node* buildList(S& s, std::size_t n) {
+  Node* head = nullptr;
+  Node* tail = nullptr;
+  for (std::size_t k = 0; k < n; k++) {
+    auto node = s.create();
+    node->value = k;
+    if (tail) {
+      tail->next = node;
+    } else {
+      head = node;
+    }
+    tail = node;
+  }
+  return head;
+}
+
+template <PageBacking B>
+bool skipIfUnavailable(benchmark::State& state) {
+  if (isPageBackingAvailable(B)) return false;
+  state.SkipWithError("Huge pages are not available.");
+  return true;
+}
+
+template <typename S, PageBacking B = PageBacking::kRegular>
+void benchArenaBuild(benchmark::State& state) {
+  if (skipIfUnavailable<B>(state)) return;
+  auto n = static_cast<std::size_t>(state.range(0));
+  S s;
+
+  while (state.KeepRunningBatch(n)) {
+    auto head = buildList(s, n);
+    benchmark::DoNotOptimize(head);
+    s.clear(head);
+  }
+}
+
+template <typename S, PageBacking B = PageBacking::kRegular>
+void benchArenaWalk(benchmark::State& state) {
+  if (skipIfUnavailable<B>(state)) return;
+  auto n = static_cast<std::size_t>(state.range(0));
+  S s;
+  auto head = buildList(s, n);
+
+  while (state.KeepRunningBatch(n)) {
+    std::uint64_t sum = 0;
+    for (auto node = head; node; node = node->next) sum += node->value;
+    benchmark::DoNotOptimize(sum);
+  }
+
+  s.clear(head);
+}
+
+void listArgs(benchmark::internal::Benchmark* b) {
+  b->RangeMultiplier(8)->Range(1 << 10, 1 << 20);
+}
+
+using RegularArena = ArenaNew<PageBacking::kRegular>;
+using HugeArena = ArenaNew<PageBacking::kTransparent>;
+
+// Time per node to build (and free) and to walk a linked list of 64 byte
+// nodes, 64 KB to 64 MB in total.
+//
+// Building from an arena is a pointer bump per node and freeing the whole list
+// is one reset(), while new/delete pays for malloc bookkeeping per node.
+//
+// Walking is a chain of dependent loads so its cost depends on where the next
+// node lives. In the arena consecutive nodes are adjacent, like benchSeqWalk<7>
+// in bench/cacheeffects.cpp, and the prefetchers keep up. Plain new on a fresh
+// heap also carves consecutive nodes out of the top of the heap, but malloc's
+// per-chunk header makes every node straddle two cache lines. Once other
+// allocations are interleaved (FragmentedNew) nodes are spread over ~3x more
+// memory and the gaps between them vary, so the walk touches more cache lines
+// and pages and the stride prefetcher can't lock on. Transparent huge pages
+// shave off the remaining TLB misses for the largest lists.
+BENCHMARK_TEMPLATE(benchArenaBuild, New)->Apply(listArgs);
+BENCHMARK_TEMPLATE(benchArenaBuild, FragmentedNew)->Apply(listArgs);
+BENCHMARK_TEMPLATE(benchArenaBuild, RegularArena)->Apply(listArgs);
+BENCHMARK_TEMPLATE(benchArenaBuild, HugeArena, PageBacking::kTransparent)
+    ->Apply(listArgs);
+BENCHMARK_TEMPLATE(benchArenaWalk, New)->Apply(listArgs);
+BENCHMARK_TEMPLATE(benchArenaWalk, FragmentedNew)->Apply(listArgs);
+BENCHMARK_TEMPLATE(benchArenaWalk, RegularArena)->Apply(listArgs);
+BENCHMARK_TEMPLATE(benchArenaWalk, HugeArena, PageBacking::kTransparent)
+    ->Apply(listArgs);
+
+}  // namespace
+}  // namespace bits
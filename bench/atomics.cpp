@@ -1,15 +1,29 @@
+#include <array>
 #include <atomic>
+#include <cstddef>
 #include <cstdint>
 
 #include <benchmark/benchmark.h>
 
+#include <bits/cache_padded.hpp>
+#include <bits/thread_pool.hpp>
+
+#include "environment.hpp"
+
 namespace bits {
 namespace {
 
 constexpr auto N = 1'000'000;
 
+constexpr auto kMaxThreads = 256;
+
 std::atomic<std::uint64_t> x;
 
+// Per-thread counters packed next to each other (8 counters per 64 byte cache
+// line) vs. each on its own cache line.
+std::array<std::atomic<std::uint64_t>, kMaxThreads> unpadded;
+std::array<CachePadded<std::atomic<std::uint64_t>>, kMaxThreads> padded;
+
 // clang-format off
 // 2019-04-06 20:43:33
 // Running ./bits-bench
@@ -35,6 +49,7 @@ std::atomic<std::uint64_t> x;
 //        0.171581456 seconds time elapsed
 // clang-format on
 void benchAtomicsLoad(benchmark::State& state) {
+  auto pin = pinBenchThread(state);
   while (state.KeepRunningBatch(N)) {
     for (auto k = 0; k < N; k++)
       benchmark::DoNotOptimize(x.load(std::memory_order::memory_order_relaxed));
@@ -66,6 +81,7 @@ void benchAtomicsLoad(benchmark::State& state) {
 //        0.169033016 seconds time elapsed
 // clang-format on
 void benchAtomicsFetchOr(benchmark::State& state) {
+  auto pin = pinBenchThread(state);
   while (state.KeepRunningBatch(N)) {
     for (auto k = 0; k < N; k++)
       benchmark::DoNotOptimize(
@@ -73,6 +89,23 @@ void benchAtomicsFetchOr(benchmark::State& state) {
   }
 }
 
+void benchFetchAdd(benchmark::State& state, std::atomic<std::uint64_t>& y) {
+  auto pin = pinBenchThread(state);
+  while (state.KeepRunningBatch(N)) {
+    for (auto k = 0; k < N; k++)
+      benchmark::DoNotOptimize(
+          y.fetch_add(1, std::memory_order::memory_order_relaxed));
+  }
+}
+
+void benchAtomicsFetchAddUnpadded(benchmark::State& state) {
+  benchFetchAdd(state, unpadded[state.thread_index % kMaxThreads]);
+}
+
+void benchAtomicsFetchAddPadded(benchmark::State& state) {
+  benchFetchAdd(state, *padded[state.thread_index % kMaxThreads]);
+}
+
 // This benchmark shows the different between a simple atomic load and a
 // read-modify-write operation that might need to do "more" cross core
 // synchronization. We can observe a monumentally higher L1 cache miss rate when
@@ -80,5 +113,189 @@ void benchAtomicsFetchOr(benchmark::State& state) {
 BENCHMARK(benchAtomicsLoad)->ThreadPerCpu();
 BENCHMARK(benchAtomicsFetchOr)->ThreadPerCpu();
 
+// Each thread increments its own counter so there is no true sharing. However,
+// unpadded counters share cache lines and every fetch_add(...) still has to
+// steal the line from the other cores (false sharing). Padded counters should
+// scale linearly with the number of threads, this is what RcuRefCounter relies
+// on for fast RCU readers.
+BENCHMARK(benchAtomicsFetchAddUnpadded)->ThreadRange(1, 16);
+BENCHMARK(benchAtomicsFetchAddPadded)->ThreadRange(1, 16);
+
+// Memory orderings for the matrix below: the order of read-modify-writes and
+// of plain stores (which can't be acq_rel).
+struct Relaxed {
+  static constexpr auto kRmw = std::memory_order_relaxed;
+  static constexpr auto kStore = std::memory_order_relaxed;
+};
+
+struct AcqRel {
+  static constexpr auto kRmw = std::memory_order_acq_rel;
+  static constexpr auto kStore = std::memory_order_release;
+};
+
+struct SeqCst {
+  static constexpr auto kRmw = std::memory_order_seq_cst;
+  static constexpr auto kStore = std::memory_order_seq_cst;
+};
+
+constexpr std::memory_order getFailureOrder(std::memory_order order) {
+  return order == std::memory_order_acq_rel ? std::memory_order_acquire
+                                            : order;
+}
+
+template <typename O>
+struct FetchAdd {
+  static void run(std::atomic<std::uint64_t>& y, std::uint64_t) {
+    y.fetch_add(1, O::kRmw);
+  }
+};
+
+// An increment via a compare_exchange_weak(...) loop, like most lock-free
+// updates which can't be expressed as a single fetch_...(...). Retries when
+// other threads win the race.
+template <typename O>
+struct CasLoop {
+  static void run(std::atomic<std::uint64_t>& y, std::uint64_t) {
+    auto v = y.load(std::memory_order_relaxed);
+    while (!y.compare_exchange_weak(v, v + 1, O::kRmw,
+                                    getFailureOrder(O::kRmw))) {
+    }
+  }
+};
+
+template <typename O>
+struct Exchange {
+  static void run(std::atomic<std::uint64_t>& y, std::uint64_t k) {
+    benchmark::DoNotOptimize(y.exchange(k, O::kRmw));
+  }
+};
+
+template <typename O>
+struct Store {
+  static void run(std::atomic<std::uint64_t>& y, std::uint64_t k) {
+    y.store(k, O::kStore);
+  }
+};
+
+// Where the threads of the matrix run. SMT siblings share a core (and its L1
+// and L2), threads on the same socket share the L3 and threads across sockets
+// share nothing but the interconnect.
+enum MatrixPlacement : int {
+  // Left to the scheduler (or --bits_placement).
+  kUnpinned,
+  kSiblings,
+  kSameSocket,
+  kCrossSocket,
+};
+
+CachePadded<std::atomic<std::uint64_t>> shared;
+
+// Returns an error if the topology can't place the threads as requested.
+const char* checkMatrixPlacement(MatrixPlacement placement,
+                                 std::size_t threads) {
+  auto& topology = getBenchTopology();
+  if (placement == kUnpinned) return nullptr;
+  if (threads > topology.cpus().size()) return "More threads than cpus";
+  switch (placement) {
+    case kSiblings: {
+      // Compact placement fills the siblings of one core before moving on to
+      // the next, all threads have to fit on the first one.
+      auto cpus = placeThreads(topology, Placement::kCompact, threads);
+      auto coreOf = [&](std::size_t cpu) {
+        for (auto& info : topology.cpus()) {
+          if (info.cpu == cpu) return info.core;
+        }
+        return cpu;
+      };
+      for (auto cpu : cpus) {
+        if (coreOf(cpu) != coreOf(cpus.front()))
+          return "More threads than SMT siblings per core";
+      }
+      for (auto& core : topology.cores()) {
+        if (core.size() > 1) return nullptr;
+      }
+      return "No SMT siblings";
+    }
+    case kSameSocket:
+      if (threads > topology.cores().size() / topology.packages().size())
+        return "More threads than cores per socket";
+      return nullptr;
+    case kCrossSocket:
+      if (topology.packages().size() < 2) return "Single socket";
+      return nullptr;
+    default:
+      return nullptr;
+  }
+}
+
+Placement toPlacement(MatrixPlacement placement) {
+  switch (placement) {
+    case kSiblings:
+      return Placement::kCompact;
+    case kSameSocket:
+      return Placement::kPhysicalCores;
+    case kCrossSocket:
+      return Placement::kScatter;
+    default:
+      return getBenchPlacement();
+  }
+}
+
+template <template <typename> class Op, typename O>
+void benchAtomicsMatrix(benchmark::State& state) {
+  auto isPrivate = state.range(0) != 0;
+  auto placement = static_cast<MatrixPlacement>(state.range(1));
+  if (auto error = checkMatrixPlacement(
+          placement, static_cast<std::size_t>(state.threads))) {
+    state.SkipWithError(error);
+    return;
+  }
+  auto pin = pinBenchThread(state, toPlacement(placement));
+
+  auto& y = isPrivate ? *padded[state.thread_index % kMaxThreads] : *shared;
+  while (state.KeepRunningBatch(N)) {
+    for (auto k = 0; k < N; k++) Op<O>::run(y, static_cast<std::uint64_t>(k));
+  }
+}
+
+void matrixArgs(benchmark::internal::Benchmark* b) {
+  b->ArgNames({"private", "placement"});
+  for (auto isPrivate : {0, 1}) {
+    for (auto placement : {kUnpinned, kSiblings, kSameSocket, kCrossSocket})
+      b->Args({isPrivate, placement});
+  }
+  b->ThreadRange(1, 16);
+}
+
+// The cost of each atomic operation and memory order, on a line shared by all
+// threads (private:0) vs. a padded line per thread (private:1), with threads
+// placed on SMT siblings (placement:1), cores of the same socket (placement:2)
+// or across sockets (placement:3). Placements the host can't provide are
+// skipped.
+//
+// On x86-64 every read-modify-write is a locked instruction, a full barrier,
+// so the memory order makes no difference for FetchAdd, CasLoop and Exchange.
+// Only seq_cst stores pay extra: they compile to xchg instead of mov. On
+// weakly ordered cpus (e.g. aarch64) acq_rel and seq_cst add barriers (or use
+// the more expensive acquire/release variants of the atomic instructions).
+//
+// Private lines should scale linearly with the number of threads. Shared lines
+// bounce between cores, and the cost grows with the distance between them:
+// siblings share the L1 so they should be cheapest, cross-socket transfers
+// the most expensive (see bin/corelatency.cpp). CasLoop degrades
+// faster than FetchAdd under contention since failed CASes retry.
+BENCHMARK_TEMPLATE(benchAtomicsMatrix, FetchAdd, Relaxed)->Apply(matrixArgs);
+BENCHMARK_TEMPLATE(benchAtomicsMatrix, FetchAdd, AcqRel)->Apply(matrixArgs);
+BENCHMARK_TEMPLATE(benchAtomicsMatrix, FetchAdd, SeqCst)->Apply(matrixArgs);
+BENCHMARK_TEMPLATE(benchAtomicsMatrix, CasLoop, Relaxed)->Apply(matrixArgs);
+BENCHMARK_TEMPLATE(benchAtomicsMatrix, CasLoop, AcqRel)->Apply(matrixArgs);
+BENCHMARK_TEMPLATE(benchAtomicsMatrix, CasLoop, SeqCst)->Apply(matrixArgs);
+BENCHMARK_TEMPLATE(benchAtomicsMatrix, Exchange, Relaxed)->Apply(matrixArgs);
+BENCHMARK_TEMPLATE(benchAtomicsMatrix, Exchange, AcqRel)->Apply(matrixArgs);
+BENCHMARK_TEMPLATE(benchAtomicsMatrix, Exchange, SeqCst)->Apply(matrixArgs);
+BENCHMARK_TEMPLATE(benchAtomicsMatrix, Store, Relaxed)->Apply(matrixArgs);
+BENCHMARK_TEMPLATE(benchAtomicsMatrix, Store, AcqRel)->Apply(matrixArgs);
+BENCHMARK_TEMPLATE(benchAtomicsMatrix, Store, SeqCst)->Apply(matrixArgs);
+
 }  // namespace
 }  // namespace bits
@@ -0,0 +1,151 @@
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include <benchmark/benchmark.h>
+
+#include <bits/cache_padded.hpp>
+
+#include "environment.hpp"
+
+namespace bits {
+namespace {
+
+constexpr double kScalar = 3.0;
+
+// How results are written back to memory:
+//
+// - Regular: Plain C++ loop, the compiler may or may not vectorize it.
+// - Simd: Explicit 16 byte SSE2 loads and stores.
+// - Stream: SSE2 non-temporal stores which write combine full cache lines and
+//   bypass the cache hierarchy. This avoids the read-for-ownership of the
+//   destination cache line and does not evict the working set.
+enum class Store { kRegular, kSimd, kStream };
+
+// The 4 STREAM kernels: https://www.cs.virginia.edu/stream/ref.html
+struct Copy {
+  static constexpr std::size_t kReads = 1;
+  static double apply(double b, double) { return b; }
+#if defined(__SSE2__)
+  static __m128d apply(__m128d b, __m128d) { return b; }
+#endif
+};
+
+struct Scale {
+  static constexpr std::size_t kReads = 1;
+  static double apply(double b, double) { return kScalar * b; }
+#if defined(__SSE2__)
+  static __m128d apply(__m128d b, __m128d) {
+    return _mm_mul_pd(_mm_set1_pd(kScalar), b);
+  }
+#endif
+};
+
+struct Add {
+  static constexpr std::size_t kReads = 2;
+  static double apply(double b, double c) { return b + c; }
+#if defined(__SSE2__)
+  static __m128d apply(__m128d b, __m128d c) { return _mm_add_pd(b, c); }
+#endif
+};
+
+struct Triad {
+  static constexpr std::size_t kReads = 2;
+  static double apply(double b, double c) { return b + kScalar * c; }
+#if defined(__SSE2__)
+  static __m128d apply(__m128d b, __m128d c) {
+    return _mm_add_pd(b, _mm_mul_pd(_mm_set1_pd(kScalar), c));
+  }
+#endif
+};
+
+template <typename K, Store S>
+void runKernel(double* a, const double* b, const double* c, std::size_t n) {
+#if defined(__SSE2__)
+  if (S != Store::kRegular) {
+    for (std::size_t k = 0; k < n; k += 2) {
+      auto v = K::apply(_mm_load_pd(b + k), _mm_load_pd(c + k));
+      if (S == Store::kStream) {
+        _mm_stream_pd(a + k, v);
+      } else {
+        _mm_store_pd(a + k, v);
+      }
+    }
+    // Non-temporal stores are weakly ordered, make sure they are globally
+    // visible before the next pass.
+    if (S == Store::kStream) _mm_sfence();
+    return;
+  }
+#endif
+  for (std::size_t k = 0; k < n; k++) a[k] = K::apply(b[k], c[k]);
+}
+
+template <typename K, Store S>
+void benchBandwidth(benchmark::State& state) {
+  auto pin = pinBenchThread(state);
+  using Array = std::vector<double, CacheAlignedAllocator<double>>;
+
+  // The working set is split evenly between the arrays read and written by the
+  // kernel. Rounded to a multiple of 8 doubles (64 bytes) so SIMD loops don't
+  // need a remainder loop.
+  auto workingSetSize = static_cast<std::size_t>(state.range(0));
+  auto n = workingSetSize / ((K::kReads + 1) * sizeof(double)) / 8 * 8;
+
+  // Each thread works on private arrays. Allocating (and first touching) the
+  // arrays on the benchmark thread keeps them on the local NUMA node.
+  Array a(n, 0.0);
+  Array b(n, 1.0);
+  Array c(n, 2.0);
+
+  while (state.KeepRunning()) {
+    runKernel<K, S>(a.data(), b.data(), c.data(), n);
+    benchmark::ClobberMemory();
+  }
+
+  // Only count bytes explicitly read/written by the kernel like STREAM does.
+  // Regular and SIMD stores also read the destination line before writing it
+  // so the actual memory traffic is higher.
+  state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations()) *
+                          static_cast<std::int64_t>(n * (K::kReads + 1) *
+                                                    sizeof(double)));
+}
+
+void bandwidthArgs(benchmark::internal::Benchmark* b) {
+  b->RangeMultiplier(8)->Range(1 << 12, 1 << 27)->ThreadRange(1, 16);
+  b->UseRealTime();
+}
+
+// STREAM style memory bandwidth benchmarks. Each thread runs a kernel over its
+// own arrays, the bytes_per_second column reports the aggregate bandwidth of
+// all threads. Working sets from 4 KB to 128 MB per thread show bandwidth of
+// each level of cache and DRAM. Adding threads shows where bandwidth of a
+// shared level (L3 and DRAM) saturates.
+//
+// Non-temporal stores should only win once the working set no longer fits in
+// the last level cache: they avoid the read-for-ownership (Copy moves 2/3 of
+// the bytes a regular copy does) and do not pollute the cache. For working
+// sets that fit in cache they are much slower because every pass has to go
+// all the way to DRAM.
+//
+// https://www.cs.virginia.edu/stream/ref.html
+BENCHMARK_TEMPLATE(benchBandwidth, Copy, Store::kRegular)->Apply(bandwidthArgs);
+BENCHMARK_TEMPLATE(benchBandwidth, Copy, Store::kSimd)->Apply(bandwidthArgs);
+BENCHMARK_TEMPLATE(benchBandwidth, Copy, Store::kStream)->Apply(bandwidthArgs);
+BENCHMARK_TEMPLATE(benchBandwidth, Scale, Store::kRegular)
+    ->Apply(bandwidthArgs);
+BENCHMARK_TEMPLATE(benchBandwidth, Scale, Store::kSimd)->Apply(bandwidthArgs);
+BENCHMARK_TEMPLATE(benchBandwidth, Scale, Store::kStream)->Apply(bandwidthArgs);
+BENCHMARK_TEMPLATE(benchBandwidth, Add, Store::kRegular)->Apply(bandwidthArgs);
+BENCHMARK_TEMPLATE(benchBandwidth, Add, Store::kSimd)->Apply(bandwidthArgs);
+BENCHMARK_TEMPLATE(benchBandwidth, Add, Store::kStream)->Apply(bandwidthArgs);
+BENCHMARK_TEMPLATE(benchBandwidth, Triad, Store::kRegular)
+    ->Apply(bandwidthArgs);
+BENCHMARK_TEMPLATE(benchBandwidth, Triad, Store::kSimd)->Apply(bandwidthArgs);
+BENCHMARK_TEMPLATE(benchBandwidth, Triad, Store::kStream)->Apply(bandwidthArgs);
+
+}  // namespace
+}  // namespace bits
@@ -5,6 +5,8 @@
 
 #include <benchmark/benchmark.h>
 
+#include <bits/pages.hpp>
+
 namespace bits {
 namespace {
 
@@ -16,16 +18,34 @@ struct Chunk {
   std::array<char, P * sizeof(Chunk<P>*)> buf;
 };
 
+// A chunk which additionally contains a "jump" pointer to a chunk further
+// ahead in the list. This is one pointer bigger than a Chunk<P>.
+template <std::size_t P>
+struct JumpChunk {
+  JumpChunk<P>* next = nullptr;
+  JumpChunk<P>* jump = nullptr;
+  std::array<char, P * sizeof(JumpChunk<P>*)> buf;
+};
+
 static_assert(sizeof(Chunk<1>) == sizeof(void*) * 2, "Chunk has bad size.");
 static_assert(sizeof(Chunk<2>) == sizeof(void*) * 3, "Chunk has bad size.");
+static_assert(sizeof(JumpChunk<1>) == sizeof(void*) * 3, "Chunk has bad size.");
+static_assert(sizeof(JumpChunk<6>) == sizeof(Chunk<7>), "Chunk has bad size.");
+
+template <std::size_t P>
+using Chunks = std::vector<Chunk<P>, PageAllocator<Chunk<P>>>;
 
+// The kind of pages actually backing the chunks is stored in *actual if
+// provided.
 template <std::size_t P>
-std::vector<Chunk<P>> makeSeqChunks(std::size_t workingSetSize) {
+Chunks<P> makeSeqChunks(std::size_t workingSetSize, PageBacking backing,
+                        PageBacking* actual = nullptr) {
   constexpr auto kChunkSize = sizeof(Chunk<P>);
 
   auto n = (workingSetSize + kChunkSize - 1) / kChunkSize;
 
-  std::vector<Chunk<P>> chunks;
+  Chunks<P> chunks{PageAllocator<Chunk<P>>{backing, actual}};
+  chunks.reserve(n);
   while (chunks.size() < n) {
     chunks.emplace_back();
   }
@@ -40,14 +60,15 @@ std::vector<Chunk<P>> makeSeqChunks(std::size_t workingSetSize) {
 }
 
 template <std::size_t P>
-std::vector<Chunk<P>> makeRngChunks(std::size_t workingSetSize) {
-  auto chunks = makeSeqChunks<P>(workingSetSize);
+Chunks<P> makeRngChunks(std::size_t workingSetSize, PageBacking backing,
+                        PageBacking* actual = nullptr) {
+  auto chunks = makeSeqChunks<P>(workingSetSize, backing, actual);
   std::random_shuffle(chunks.begin(), chunks.end());
   return chunks;
 }
 
 template <std::size_t P>
-void benchWalk(const std::vector<Chunk<P>>& chunks, benchmark::State& state) {
+void benchWalk(const Chunks<P>& chunks, benchmark::State& state) {
   constexpr std::size_t kLoopBatch = 1'000'000;
 
   auto chunk = &chunks[0];
@@ -61,15 +82,37 @@ void benchWalk(const std::vector<Chunk<P>>& chunks, benchmark::State& state) {
   }
 }
 
-template <std::size_t P>
+template <std::size_t P, PageBacking B = PageBacking::kRegular>
 void benchSeqWalk(benchmark::State& state) {
-  auto chunks = makeSeqChunks<P>(static_cast<std::size_t>(state.range(0)));
+  if (!isPageBackingAvailable(B)) {
+    state.SkipWithError("Huge pages are not available.");
+    return;
+  }
+  auto actual = B;
+  auto chunks =
+      makeSeqChunks<P>(static_cast<std::size_t>(state.range(0)), B, &actual);
+  if (actual != B) {
+    // E.g. the hugetlbfs pool is smaller than the working set.
+    state.SkipWithError("Huge pages are not available for the working set.");
+    return;
+  }
   benchWalk(chunks, state);
 }
 
-template <std::size_t P>
+template <std::size_t P, PageBacking B = PageBacking::kRegular>
 void benchRngWalk(benchmark::State& state) {
-  auto chunks = makeRngChunks<P>(static_cast<std::size_t>(state.range(0)));
+  if (!isPageBackingAvailable(B)) {
+    state.SkipWithError("Huge pages are not available.");
+    return;
+  }
+  auto actual = B;
+  auto chunks =
+      makeRngChunks<P>(static_cast<std::size_t>(state.range(0)), B, &actual);
+  if (actual != B) {
+    // E.g. the hugetlbfs pool is smaller than the working set.
+    state.SkipWithError("Huge pages are not available for the working set.");
+    return;
+  }
   benchWalk(chunks, state);
 }
 
@@ -183,5 +226,204 @@ BENCHMARK_TEMPLATE(benchRngWalk, 31)
     ->RangeMultiplier(4)
     ->Range(1 << 12, 1 << 28);
 
+// The benchmarks above place chunks on 4 KB pages so random walks over large
+// working sets miss in the TLB on almost every hop once the working set
+// exceeds the STLB reach (see bin/tlb.cpp), e.g. 1536 entries * 4 KB = 6 MB.
+// The same walks over chunks on 2 MB huge pages separate the cost of TLB misses
+// from the cost of cache misses: the STLB reach grows to 3 GB so any remaining
+// slowdown comes from the caches.
+//
+// Transparent huge pages need THP set to "always" or "madvise" in
+// /sys/kernel/mm/transparent_hugepage/enabled and the kernel may silently fall
+// back to 4 KB pages if memory is fragmented. Explicit huge pages need a
+// hugetlbfs pool, e.g. sysctl -w vm.nr_hugepages=512 for 1 GB of 2 MB pages.
+// Benchmarks are skipped if the pages are not available.
+BENCHMARK_TEMPLATE(benchSeqWalk, 31, PageBacking::kTransparent)
+    ->RangeMultiplier(4)
+    ->Range(1 << 12, 1 << 28);
+BENCHMARK_TEMPLATE(benchSeqWalk, 31, PageBacking::kExplicit)
+    ->RangeMultiplier(4)
+    ->Range(1 << 12, 1 << 28);
+
+BENCHMARK_TEMPLATE(benchRngWalk, 1, PageBacking::kTransparent)
+    ->RangeMultiplier(4)
+    ->Range(1 << 12, 1 << 28);
+BENCHMARK_TEMPLATE(benchRngWalk, 1, PageBacking::kExplicit)
+    ->RangeMultiplier(4)
+    ->Range(1 << 12, 1 << 28);
+BENCHMARK_TEMPLATE(benchRngWalk, 31, PageBacking::kTransparent)
+    ->RangeMultiplier(4)
+    ->Range(1 << 12, 1 << 28);
+BENCHMARK_TEMPLATE(benchRngWalk, 31, PageBacking::kExplicit)
+    ->RangeMultiplier(4)
+    ->Range(1 << 12, 1 << 28);
+
+constexpr std::size_t kMaxChains = 16;
+
+// Chunks linked into chains which visit the chunks in a random order.
+template <typename C>
+struct Chains {
+  std::vector<C, PageAllocator<C>> chunks{
+      PageAllocator<C>{PageBacking::kRegular}};
+  std::vector<C*> heads;
+};
+
+// Links the chunks into numOfChains independent, equal length, cyclic chains.
+// Each chain visits a random subset of the chunks in a random order.
+template <typename C>
+Chains<C> makeRngChains(std::size_t workingSetSize, std::size_t numOfChains) {
+  auto n = (workingSetSize + sizeof(C) - 1) / sizeof(C);
+  n = (n + numOfChains - 1) / numOfChains * numOfChains;
+
+  Chains<C> chains;
+  chains.chunks.resize(n);
+
+  std::vector<C*> order;
+  for (C& c : chains.chunks) order.push_back(&c);
+  std::random_shuffle(order.begin(), order.end());
+
+  for (std::size_t chain = 0; chain < numOfChains; chain++) {
+    chains.heads.push_back(order[chain]);
+    for (auto k = chain; k < n; k += numOfChains)
+      order[k]->next = order[(k + numOfChains) % n];
+  }
+
+  return chains;
+}
+
+// Points the jump pointer of each chunk hops ahead in its chain.
+template <std::size_t P>
+void linkJumps(Chains<JumpChunk<P>>& chains, std::size_t hops) {
+  for (auto head : chains.heads) {
+    std::vector<JumpChunk<P>*> chain;
+    auto c = head;
+    do {
+      chain.push_back(c);
+      c = c->next;
+    } while (c != head);
+
+    for (std::size_t k = 0; k < chain.size(); k++)
+      chain[k]->jump = chain[(k + hops) % chain.size()];
+  }
+}
+
+// Copies the chain starting at head into a new contiguous arena in traversal
+// order. Walking the copy is a sequential walk.
+template <std::size_t P>
+Chunks<P> relayout(const Chunk<P>* head) {
+  Chunks<P> arena{PageAllocator<Chunk<P>>{PageBacking::kRegular}};
+  auto c = head;
+  do {
+    arena.push_back(*c);
+    c = c->next;
+  } while (c != head);
+
+  for (std::size_t k = 0; k < arena.size(); k++)
+    arena[k].next = &arena[(k + 1) % arena.size()];
+  return arena;
+}
+
+template <std::size_t P>
+void benchPrefetchWalk(benchmark::State& state) {
+  constexpr std::size_t kLoopBatch = 1'000'000;
+
+  auto chains = makeRngChains<JumpChunk<P>>(
+      static_cast<std::size_t>(state.range(0)), 1);
+  linkJumps(chains, static_cast<std::size_t>(state.range(1)));
+
+  auto chunk = chains.heads[0];
+
+  while (state.KeepRunningBatch(kLoopBatch)) {
+    auto hops = kLoopBatch;
+    while (hops-- > 0) {
+      __builtin_prefetch(chunk->jump);
+      chunk = chunk->next;
+      benchmark::DoNotOptimize(chunk);
+    }
+  }
+}
+
+template <std::size_t P>
+void benchInterleavedWalk(benchmark::State& state) {
+  constexpr std::size_t kLoopBatch = 1'000'000;
+
+  auto numOfChains = static_cast<std::size_t>(state.range(1));
+  auto chains = makeRngChains<Chunk<P>>(
+      static_cast<std::size_t>(state.range(0)), numOfChains);
+
+  std::array<Chunk<P>*, kMaxChains> chunks;
+  std::copy(chains.heads.begin(), chains.heads.end(), chunks.begin());
+
+  // Each round hops once on each chain, all of these loads are independent
+  // and can be in flight at the same time. The remaining hops of a batch are
+  // taken on the first chains.
+  auto rounds = kLoopBatch / numOfChains;
+  auto remainder = kLoopBatch % numOfChains;
+  while (state.KeepRunningBatch(kLoopBatch)) {
+    for (auto round = rounds; round > 0; round--) {
+      for (std::size_t chain = 0; chain < numOfChains; chain++) {
+        chunks[chain] = chunks[chain]->next;
+        benchmark::DoNotOptimize(chunks[chain]);
+      }
+    }
+    for (std::size_t chain = 0; chain < remainder; chain++) {
+      chunks[chain] = chunks[chain]->next;
+      benchmark::DoNotOptimize(chunks[chain]);
+    }
+  }
+}
+
+template <std::size_t P>
+void benchRelayoutWalk(benchmark::State& state) {
+  auto chains = makeRngChains<Chunk<P>>(
+      static_cast<std::size_t>(state.range(0)), 1);
+  auto arena = relayout(chains.heads[0]);
+  benchWalk(arena, state);
+}
+
+void prefetchArgs(benchmark::internal::Benchmark* b) {
+  for (auto workingSetSize = 1 << 12; workingSetSize <= 1 << 28;
+       workingSetSize *= 4) {
+    for (auto hops : {0, 1, 2, 4, 8, 16}) b->Args({workingSetSize, hops});
+  }
+}
+
+void interleavedArgs(benchmark::internal::Benchmark* b) {
+  for (auto workingSetSize = 1 << 12; workingSetSize <= 1 << 28;
+       workingSetSize *= 4) {
+    for (auto chains = 1; chains <= static_cast<int>(kMaxChains); chains *= 2)
+      b->Args({workingSetSize, chains});
+  }
+}
+
+// Techniques for hiding the DRAM latency of the random walks above. Each
+// benchmark reports the time per hop so they compare directly with
+// benchRngWalk<7> (64 byte chunks, one chunk per cache line).
+//
+// 1. benchPrefetchWalk<6>/<working set>/<k> issues a software prefetch for the
+//    chunk k hops ahead. The jump pointer takes the place of a pointer of
+//    padding so chunks are 64 bytes too. Prefetching the next chunk is useless
+//    because we need to load it to find the address anyways. Prefetching
+//    further ahead needs a jump pointer which costs memory and has to be
+//    maintained on insertion and removal. k = 0 prefetches the current chunk
+//    which is a no-op baseline. A k which is too big prefetches lines which are
+//    evicted before they are used.
+//
+// 2. benchInterleavedWalk<7>/<working set>/<chains> walks several independent
+//    chains in lock-step. A single walk has at most 1 cache miss in flight
+//    while the core can track 10+ outstanding L1 misses (line fill buffers).
+//    This is the way to go when there are several lists (hash table buckets,
+//    batches of lookups, etc.) to traverse.
+//
+// 3. benchRelayoutWalk<7>/<working set> copies a random list into an arena in
+//    traversal order once and walks the copy. This turns the random walk into
+//    a sequential walk which the hardware prefetcher handles perfectly. This is
+//    the best option for lists which are built once and walked many times.
+BENCHMARK_TEMPLATE(benchPrefetchWalk, 6)->Apply(prefetchArgs);
+BENCHMARK_TEMPLATE(benchInterleavedWalk, 7)->Apply(interleavedArgs);
+BENCHMARK_TEMPLATE(benchRelayoutWalk, 7)
+    ->RangeMultiplier(4)
+    ->Range(1 << 12, 1 << 28);
+
 }  // namespace
 }  // namespace bits
@@ -1,6 +1,18 @@
+// boost::variant is limited to 20 types unless MPL is configured (before any
+// boost header) for longer type lists, up to 50.
+#define BOOST_MPL_CFG_NO_PREPROCESSED_HEADERS
+#define BOOST_MPL_LIMIT_LIST_SIZE 50
+
 #include <array>
 #include <cstdint>
 #include <cstdlib>
+#include <random>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include <boost/preprocessor/repetition/repeat.hpp>
+#include <boost/variant.hpp>
 
 #include <benchmark/benchmark.h>
 
@@ -171,5 +183,233 @@ BENCHMARK(benchDispatch1);
 BENCHMARK(benchDispatch2);
 BENCHMARK(benchDispatch3);
 
+// The benchmarks below dispatch a call to one of up to kMaxTypes types, like a
+// plugin engine calling into its plugins, with each of the common strategies.
+// BOOST_PP_REPEAT(...) in callSwitch(...) needs the count as a literal.
+#define BITS_DISPATCH_MAX_TYPES 48
+
+constexpr std::size_t kMaxTypes = BITS_DISPATCH_MAX_TYPES;
+
+// Calls per batch. Enough that branch predictors can't learn a random order
+// and few enough that the operands stay in L2, unlike N above.
+constexpr auto kCalls = 1 << 16;
+
+// The same work for every type, the static keeps the compiler from merging
+// the functions.
+template <std::size_t I>
+void* work() {
+  static int x;
+  x++;
+  return &x;
+}
+
+struct Plugin {
+  explicit Plugin(std::size_t id) : id{id} {}
+  virtual ~Plugin() {}
+  virtual void* f() = 0;
+  const std::size_t id;
+};
+
+template <std::size_t I>
+struct PluginImpl : Plugin {
+  PluginImpl() : Plugin{I} {}
+  void* f() override { return work<I>(); }
+};
+
+template <typename T>
+struct CrtpPlugin {
+  void* f() { return static_cast<T*>(this)->fImpl(); }
+};
+
+template <std::size_t I>
+struct CrtpPluginImpl : CrtpPlugin<CrtpPluginImpl<I>> {
+  void* fImpl() { return work<I>(); }
+};
+
+template <std::size_t I>
+struct Value {
+  void* f() { return work<I>(); }
+};
+
+struct CallF : boost::static_visitor<void*> {
+  template <typename T>
+  void* operator()(T& value) const {
+    return value.f();
+  }
+};
+
+template <typename Sequence>
+struct Types;
+
+// All kMaxTypes types of each strategy.
+template <std::size_t... Is>
+struct Types<std::index_sequence<Is...>> {
+  using Variant = boost::variant<Value<Is>...>;
+  using CrtpPlugins = std::tuple<std::vector<CrtpPluginImpl<Is>>...>;
+
+  static std::array<Plugin*, kMaxTypes> getPlugins() {
+    static std::tuple<PluginImpl<Is>...> plugins;
+    return {{&std::get<Is>(plugins)...}};
+  }
+
+  static std::array<void* (*)(), kMaxTypes> getFunctions() {
+    return {{&work<Is>...}};
+  }
+
+  static Variant makeVariant(std::size_t id) {
+    static const std::array<Variant, kMaxTypes> values{{Value<Is>{}...}};
+    return values[id];
+  }
+
+  // Resizes the vector of each type to its number of calls.
+  static void resize(CrtpPlugins& plugins,
+                     const std::array<std::size_t, kMaxTypes>& counts) {
+    using Expand = int[];
+    static_cast<void>(
+        Expand{(std::get<Is>(plugins).resize(counts[Is]), 0)...});
+  }
+
+  static void callAll(CrtpPlugins& plugins) {
+    using Expand = int[];
+    static_cast<void>(Expand{(callAll(std::get<Is>(plugins)), 0)...});
+  }
+
+  template <typename T>
+  static void callAll(std::vector<T>& plugins) {
+    for (auto& plugin : plugins) benchmark::DoNotOptimize(plugin.f());
+  }
+};
+
+using AllTypes = Types<std::make_index_sequence<kMaxTypes>>;
+
+#define BITS_DISPATCH_CASE(z, i, data) \
+  case i:                              \
+    return work<i>();
+
+void* callSwitch(std::uint8_t id) {
+  switch (id) {
+    BOOST_PP_REPEAT(BITS_DISPATCH_MAX_TYPES, BITS_DISPATCH_CASE, ~)
+  }
+  return nullptr;
+}
+
+// Returns the type ids of kCalls calls given range(0) types and range(1)
+// percent randomness: a round robin over the types where each call picks a
+// random type instead with the given probability.
+std::vector<std::uint8_t> makeTypeIds(const benchmark::State& state) {
+  auto types = static_cast<std::size_t>(state.range(0));
+  auto randomness = static_cast<int>(state.range(1));
+  std::mt19937 rng{2983498};
+  std::uniform_int_distribution<std::size_t> type{0, types - 1};
+  std::uniform_int_distribution<int> percent{0, 99};
+  std::vector<std::uint8_t> ids(kCalls);
+  for (std::size_t k = 0; k < ids.size(); k++) {
+    auto id = percent(rng) < randomness ? type(rng) : k % types;
+    ids[k] = static_cast<std::uint8_t>(id);
+  }
+  return ids;
+}
+
+std::vector<Plugin*> makePlugins(const std::vector<std::uint8_t>& ids) {
+  auto plugins = AllTypes::getPlugins();
+  std::vector<Plugin*> ps;
+  for (auto id : ids) ps.push_back(plugins[id]);
+  return ps;
+}
+
+void benchDispatchVirtual(benchmark::State& state) {
+  auto ps = makePlugins(makeTypeIds(state));
+  while (state.KeepRunningBatch(kCalls)) {
+    for (auto p : ps) benchmark::DoNotOptimize(p->f());
+  }
+}
+
+void benchDispatchCrtp(benchmark::State& state) {
+  // The same number of calls per type, but grouped by type.
+  std::array<std::size_t, kMaxTypes> counts{};
+  for (auto id : makeTypeIds(state)) counts[id]++;
+  AllTypes::CrtpPlugins plugins;
+  AllTypes::resize(plugins, counts);
+  while (state.KeepRunningBatch(kCalls)) {
+    AllTypes::callAll(plugins);
+  }
+}
+
+void benchDispatchVariant(benchmark::State& state) {
+  std::vector<AllTypes::Variant> values;
+  for (auto id : makeTypeIds(state))
+    values.push_back(AllTypes::makeVariant(id));
+  while (state.KeepRunningBatch(kCalls)) {
+    for (auto& value : values)
+      benchmark::DoNotOptimize(boost::apply_visitor(CallF{}, value));
+  }
+}
+
+void benchDispatchFunctionTable(benchmark::State& state) {
+  auto ids = makeTypeIds(state);
+  auto functions = AllTypes::getFunctions();
+  while (state.KeepRunningBatch(kCalls)) {
+    for (auto id : ids) benchmark::DoNotOptimize(functions[id]());
+  }
+}
+
+void benchDispatchSwitch(benchmark::State& state) {
+  auto ids = makeTypeIds(state);
+  while (state.KeepRunningBatch(kCalls)) {
+    for (auto id : ids) benchmark::DoNotOptimize(callSwitch(id));
+  }
+}
+
+void benchDispatchBatched(benchmark::State& state) {
+  auto ps = makePlugins(makeTypeIds(state));
+  std::vector<Plugin*> sorted(ps.size());
+  while (state.KeepRunningBatch(kCalls)) {
+    // Counting sort by type, then virtual calls in runs of the same type.
+    std::array<std::size_t, kMaxTypes + 1> offsets{};
+    for (auto p : ps) offsets[p->id + 1]++;
+    for (std::size_t k = 1; k < offsets.size(); k++)
+      offsets[k] += offsets[k - 1];
+    for (auto p : ps) sorted[offsets[p->id]++] = p;
+    for (auto p : sorted) benchmark::DoNotOptimize(p->f());
+  }
+}
+
+void dispatchArgs(benchmark::internal::Benchmark* b) {
+  b->ArgNames({"types", "random"});
+  for (auto types : {1, 2, 4, 8, 16, 32, 48}) {
+    for (auto randomness : {0, 10, 100}) b->Args({types, randomness});
+  }
+}
+
+// Megamorphic dispatch with types:N types called in a round robin where
+// random:P percent of the calls go to a random type instead. Time is per call,
+// the branch-misses counter (see README) shows where each strategy breaks
+// down:
+//
+//  - Virtual: a load of the vtable and an indirect call. With a single type
+//    it's predicted perfectly, a round robin over a few types is learned from
+//    the branch history but random calls mispredict ~(N - 1) / N of the time,
+//    each a pipeline flush of ~15-20 cycles.
+//  - Crtp: the bound when the type is known statically, the calls inline and
+//    there's nothing to mispredict. Only possible when objects are stored by
+//    type, i.e. the order of calls doesn't matter.
+//  - Variant: boost::apply_visitor(...) switches on the index, which is a jump
+//    table (an indirect branch too) but saves the vtable load and inlines the
+//    calls. Types past BOOST_VARIANT_VISITATION_UNROLLING_LIMIT (20) take a
+//    second switch.
+//  - FunctionTable: an indirect call through a table indexed by a type tag,
+//    i.e. a virtual call without the vtable load.
+//  - Switch: like Variant without the library, compilers turn dense cases into
+//    a jump table so it mispredicts as often as the others.
+//  - Batched: a counting sort by type before the virtual calls. The sort costs
+//    a few ns per call but turns random calls into N predictable runs, so it
+//    wins once the calls are random enough.
+BENCHMARK(benchDispatchVirtual)->Apply(dispatchArgs);
+BENCHMARK(benchDispatchCrtp)->Apply(dispatchArgs);
+BENCHMARK(benchDispatchVariant)->Apply(dispatchArgs);
+BENCHMARK(benchDispatchFunctionTable)->Apply(dispatchArgs);
+BENCHMARK(benchDispatchSwitch)->Apply(dispatchArgs);
+BENCHMARK(benchDispatchBatched)->Apply(dispatchArgs);
+
 }  // namespace
 }  // namespace bits
@@ -0,0 +1,151 @@
+#include "environment.hpp"
+
+#include <sched.h>
+
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+
+#include <bits/affinity.hpp>
+
+namespace bits {
+namespace {
+
+struct Environment {
+  Placement placement = Placement::kNone;
+  bool isolated = false;
+  // Read before any thread is pinned, the main thread may only be allowed to
+  // run on one cpu while it runs a pinned benchmark.
+  CpuTopology topology = CpuTopology::read();
+  std::vector<std::size_t> cpus = getAllowedCpus();
+};
+
+Environment& getEnvironment() {
+  static Environment environment;
+  return environment;
+}
+
+std::vector<std::size_t> getIsolatedCpus() {
+  std::ifstream in{"/sys/devices/system/cpu/isolated"};
+  std::string list;
+  std::getline(in, list);
+  try {
+    return list.empty() ? std::vector<std::size_t>{} : parseCpuList(list);
+  } catch (const std::invalid_argument&) {
+    return {};
+  }
+}
+
+bool restrictToCpus(const std::vector<std::size_t>& cpus) {
+  ::cpu_set_t cpuset;
+  CPU_ZERO(&cpuset);
+  for (auto cpu : cpus) {
+    if (cpu < CPU_SETSIZE) CPU_SET(cpu, &cpuset);
+  }
+  return ::sched_setaffinity(0, sizeof(cpuset), &cpuset) == 0;
+}
+
+std::string getField(const HostFingerprint& fingerprint,
+                     const std::string& key) {
+  for (auto& field : fingerprint) {
+    if (field.first == key) return field.second;
+  }
+  return "";
+}
+
+}  // namespace
+
+bool configureBenchEnvironment(Placement placement, bool isolated) {
+  auto& environment = getEnvironment();
+  environment.placement = placement;
+  if (!isolated) return true;
+
+  auto cpus = getIsolatedCpus();
+  if (cpus.empty() || !restrictToCpus(cpus)) return false;
+  environment.isolated = true;
+  environment.topology = CpuTopology::read();
+  environment.cpus = getAllowedCpus();
+  if (placement == Placement::kNone)
+    environment.placement = Placement::kPhysicalCores;
+  return true;
+}
+
+Placement parsePlacement(const std::string& name) {
+  if (name == "none") return Placement::kNone;
+  if (name == "cores") return Placement::kPhysicalCores;
+  if (name == "compact") return Placement::kCompact;
+  if (name == "scatter") return Placement::kScatter;
+  throw std::invalid_argument{"Unknown placement: " + name};
+}
+
+std::string getPlacementName(Placement placement) {
+  switch (placement) {
+    case Placement::kNone:
+      return "none";
+    case Placement::kPhysicalCores:
+      return "cores";
+    case Placement::kCompact:
+      return "compact";
+    case Placement::kScatter:
+      return "scatter";
+  }
+  return "unknown";
+}
+
+Placement getBenchPlacement() { return getEnvironment().placement; }
+
+const std::vector<std::size_t>& getBenchCpus() { return getEnvironment().cpus; }
+
+const CpuTopology& getBenchTopology() { return getEnvironment().topology; }
+
+BenchThreadPin::~BenchThreadPin() {
+  if (!cpus_.empty()) restrictToCpus(cpus_);
+}
+
+BenchThreadPin pinBenchThread(const benchmark::State& state) {
+  return pinBenchThread(state, getBenchPlacement());
+}
+
+BenchThreadPin pinBenchThread(const benchmark::State& state,
+                              Placement placement) {
+  if (placement == Placement::kNone) return BenchThreadPin{};
+  auto cpus = placeThreads(getBenchTopology(), placement,
+                           static_cast<std::size_t>(state.threads));
+  BenchThreadPin pin{getAllowedCpus()};
+  pinThisThread(cpus[static_cast<std::size_t>(state.thread_index)]);
+  return pin;
+}
+
+std::vector<std::string> checkBenchEnvironment(
+    const HostFingerprint& fingerprint) {
+  std::vector<std::string> warnings;
+
+  auto governor = getField(fingerprint, "governor");
+  if (governor != "none" && governor != "performance") {
+    warnings.push_back("CPU frequency governor is " + governor +
+                       ", run scripts/cpu-scaling-off.sh to use performance");
+  }
+  if (getField(fingerprint, "turbo") == "on") {
+    warnings.push_back(
+        "Turbo is on, frequencies vary with temperature and the number of "
+        "busy cores");
+  }
+  if (getField(fingerprint, "smt") == "on" &&
+      getBenchPlacement() == Placement::kNone) {
+    warnings.push_back(
+        "SMT is on and threads are not pinned, threads may end up on "
+        "siblings of the same core (see --bits_placement)");
+  }
+  if (getField(fingerprint, "optimized") == "false") {
+    warnings.push_back(
+        "Benchmarks were built without optimizations, run meson configure "
+        "-Dbuildtype=release");
+  }
+  if (!getEnvironment().isolated && !getIsolatedCpus().empty()) {
+    warnings.push_back(
+        "The host has isolated cpus which are not used (see --bits_isolated)");
+  }
+  return warnings;
+}
+
+}  // namespace bits
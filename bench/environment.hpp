@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include <bits/cpu_topology.hpp>
+#include <bits/thread_pool.hpp>
+
+#include "host_fingerprint.hpp"
+
+namespace bits {
+
+// Sets where benchmark threads run, MUST be called before any benchmark runs.
+// With isolated the process is restricted to the cpus in
+// /sys/devices/system/cpu/isolated (isolcpus=... on the kernel command line)
+// which the scheduler keeps other tasks off. Threads are then pinned by
+// physical cores unless another placement is given since the scheduler does
+// not balance load across isolated cpus. Returns false if there are no
+// isolated cpus (or the process can't use them).
+bool configureBenchEnvironment(Placement placement, bool isolated);
+
+// Parses "none", "cores", "compact" or "scatter". Throws std::invalid_argument
+// for other values.
+Placement parsePlacement(const std::string& name);
+
+std::string getPlacementName(Placement placement);
+
+// The configured placement and the cpus threads are placed on.
+Placement getBenchPlacement();
+const std::vector<std::size_t>& getBenchCpus();
+
+// The topology of the cpus benchmark threads may run on.
+const CpuTopology& getBenchTopology();
+
+// Restores the affinity a benchmark thread had before pinBenchThread(...)
+// when destroyed. Thread 0 of a benchmark is the main thread which would
+// otherwise stay pinned for all later benchmarks (and pass the pin on to
+// threads they start).
+class BenchThreadPin {
+ public:
+  BenchThreadPin() = default;
+  explicit BenchThreadPin(std::vector<std::size_t> cpus)
+      : cpus_{std::move(cpus)} {}
+
+  BenchThreadPin(BenchThreadPin&& other) noexcept
+      : cpus_{std::move(other.cpus_)} {
+    other.cpus_.clear();
+  }
+
+  BenchThreadPin(const BenchThreadPin&) = delete;
+  BenchThreadPin& operator=(const BenchThreadPin&) = delete;
+  BenchThreadPin& operator=(BenchThreadPin&&) = delete;
+
+  ~BenchThreadPin();
+
+ private:
+  // The cpus the thread was allowed to run on, empty if it wasn't pinned.
+  std::vector<std::size_t> cpus_;
+};
+
+// Pins the calling thread of a benchmark to its cpu according to the
+// configured placement, a no-op for Placement::kNone. Multi-threaded
+// benchmarks should call this before their benchmark loop and keep the result
+// until the end of the benchmark:
+//
+//   auto pin = pinBenchThread(state);
+//
+// With more threads than cpus threads wrap around and share cpus.
+[[gnu::warn_unused_result]] BenchThreadPin pinBenchThread(
+    const benchmark::State& state);
+
+// Same but with the given placement instead of the configured one, for
+// benchmarks which measure the effect of placement.
+[[gnu::warn_unused_result]] BenchThreadPin pinBenchThread(
+    const benchmark::State& state, Placement placement);
+
+// Returns the reasons why results on this host may be noisy or not
+// reproducible between runs, e.g. a power saving governor.
+std::vector<std::string> checkBenchEnvironment(
+    const HostFingerprint& fingerprint);
+
+}  // namespace bits
@@ -0,0 +1,93 @@
+#include <cstdint>
+#include <mutex>
+#include <queue>
+#include <random>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include <bits/flat_combining.hpp>
+
+#include "environment.hpp"
+
+namespace bits {
+namespace {
+
+constexpr auto N = 10'000;
+constexpr auto kInitialSize = 1024;
+
+using PriorityQueue = std::priority_queue<std::uint64_t>;
+
+PriorityQueue makePriorityQueue() {
+  std::mt19937_64 rng;
+  PriorityQueue pq;
+  for (auto k = 0; k < kInitialSize; k++) pq.push(rng());
+  return pq;
+}
+
+class MutexPriorityQueue {
+ public:
+  template <typename F>
+  auto apply(F&& f) -> decltype(f(std::declval<PriorityQueue&>())) {
+    std::lock_guard<std::mutex> lock{mutex_};
+    return f(pq_);
+  }
+
+ private:
+  std::mutex mutex_;
+  PriorityQueue pq_ = makePriorityQueue();
+};
+
+class FlatCombiningPriorityQueue {
+ public:
+  template <typename F>
+  auto apply(F&& f) -> decltype(f(std::declval<PriorityQueue&>())) {
+    return fc_.apply(std::forward<F>(f));
+  }
+
+ private:
+  FlatCombining<PriorityQueue> fc_{makePriorityQueue()};
+};
+
+template <typename T>
+T& getShared() {
+  static T shared;
+  return shared;
+}
+
+// Every thread alternates pushing a random value and popping the top, so the
+// size of the queue stays around kInitialSize.
+template <typename T>
+void benchPriorityQueue(benchmark::State& state) {
+  auto pin = pinBenchThread(state);
+  auto& pq = getShared<T>();
+  std::mt19937_64 rng(state.thread_index);
+
+  while (state.KeepRunningBatch(N)) {
+    for (auto k = 0; k < N; k += 2) {
+      auto x = rng();
+      pq.apply([x](PriorityQueue& q) { q.push(x); });
+      benchmark::DoNotOptimize(pq.apply([](PriorityQueue& q) {
+        auto top = q.top();
+        q.pop();
+        return top;
+      }));
+    }
+  }
+}
+
+// Time per priority queue operation with all threads sharing one queue. With
+// a mutex every operation moves the lock and the heap's cache lines to the
+// calling thread, so the aggregate throughput drops as threads are added. With
+// flat combining the heap stays in the combiner's cache and each waiting
+// thread only moves its own slot, so throughput should hold up (or improve,
+// since one lock acquisition serves a whole batch).
+BENCHMARK_TEMPLATE(benchPriorityQueue, MutexPriorityQueue)
+    ->ThreadRange(1, 16)
+    ->UseRealTime();
+BENCHMARK_TEMPLATE(benchPriorityQueue, FlatCombiningPriorityQueue)
+    ->ThreadRange(1, 16)
+    ->UseRealTime();
+
+}  // namespace
+}  // namespace bits
@@ -0,0 +1,72 @@
+#include <cstdint>
+
+#include <benchmark/benchmark.h>
+
+// The call chain from bin/got_plt.c built in different ways, see
+// got_plt_variant_defs in meson.build.
+extern "C" {
+void gotPlt1_plt();
+void gotPlt1_noplt();
+void gotPlt1_now();
+void gotPlt1_symbolic();
+void gotPlt1_hidden();
+void gotPlt1_static();
+void gotPlt1_lto();
+}
+
+namespace bits {
+namespace {
+
+constexpr auto N = 1'000'000;
+
+// Calls per gotPlt1(): the call from the benchmark, 2 calls to gotPlt2() in
+// the other library and 1 call to separator() in the same library.
+constexpr std::int64_t kCallsPerChain = 4;
+
+template <void (*F)()>
+void benchGotPlt(benchmark::State& state) {
+  while (state.KeepRunningBatch(N)) {
+    for (auto k = 0; k < N; k++) {
+      F();
+      benchmark::ClobberMemory();
+    }
+  }
+  state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations()) *
+                          kCallsPerChain);
+}
+
+// Time per gotPlt1() call chain, items per second are calls per second. Every
+// call between shared libraries (and from the benchmark into one) goes through
+// the PLT: a direct call to a stub which jumps through the GOT entry for the
+// function. Variants:
+//
+// - plt: calls to gotPlt2() AND separator() go through the PLT since the
+//   default visibility separator() could be interposed by another library.
+// - noplt: -fno-plt makes calls out of the library an indirect call through
+//   the GOT, saving the jump to (and i-cache footprint of) the stub.
+// - now: -Wl,-z,now binds all symbols at load time instead of on first call.
+//   The steady state cost is the same as plt.
+// - symbolic: -Bsymbolic binds separator() to the library's own definition so
+//   that call is direct.
+// - hidden: -fvisibility=hidden tells the compiler separator() can't be
+//   interposed so it is inlined into gotPlt1().
+// - static: static libraries, every call is a direct call.
+// - lto: static libraries with LTO, gotPlt2() and separator() are inlined and
+//   only the call from the benchmark remains.
+//
+// With -Dbuildtype=release expect plt/now > noplt > symbolic > hidden > static
+// > lto, a few ns between the first and the last (debug builds don't inline).
+// The difference matters for tiny functions called in inner loops, it does not
+// for anything that does real work per call.
+BENCHMARK_TEMPLATE(benchGotPlt, &gotPlt1_plt);
+BENCHMARK_TEMPLATE(benchGotPlt, &gotPlt1_noplt);
+BENCHMARK_TEMPLATE(benchGotPlt, &gotPlt1_now);
+BENCHMARK_TEMPLATE(benchGotPlt, &gotPlt1_symbolic);
+BENCHMARK_TEMPLATE(benchGotPlt, &gotPlt1_hidden);
+BENCHMARK_TEMPLATE(benchGotPlt, &gotPlt1_static);
+#ifdef BITS_GOT_PLT_LTO
+BENCHMARK_TEMPLATE(benchGotPlt, &gotPlt1_lto);
+#endif
+
+}  // namespace
+}  // namespace bits
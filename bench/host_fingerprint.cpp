@@ -0,0 +1,178 @@
+#include "host_fingerprint.hpp"
+
+#include <sys/utsname.h>
+
+#include <fstream>
+#include <set>
+#include <sstream>
+#include <thread>
+
+#include "environment.hpp"
+
+namespace bits {
+namespace {
+
+std::string readLine(const std::string& path) {
+  std::ifstream in{path};
+  std::string line;
+  std::getline(in, line);
+  return line;
+}
+
+std::string getCpuModel() {
+  std::ifstream in{"/proc/cpuinfo"};
+  std::string line;
+  while (std::getline(in, line)) {
+    if (line.compare(0, 10, "model name") != 0) continue;
+    auto colon = line.find(':');
+    if (colon != std::string::npos && colon + 2 <= line.size())
+      return line.substr(colon + 2);
+  }
+  return "unknown";
+}
+
+// E.g. "L1d 48K, L1i 32K, L2 2048K, L3 107520K".
+std::string getCaches() {
+  std::string caches;
+  for (auto index = 0;; index++) {
+    auto dir = "/sys/devices/system/cpu/cpu0/cache/index" +
+               std::to_string(index) + "/";
+    auto level = readLine(dir + "level");
+    if (level.empty()) break;
+    auto type = readLine(dir + "type");
+    auto name = "L" + level;
+    if (type == "Data") name += "d";
+    if (type == "Instruction") name += "i";
+    if (!caches.empty()) caches += ", ";
+    caches += name + " " + readLine(dir + "size");
+  }
+  return caches.empty() ? "unknown" : caches;
+}
+
+// The distinct governors of all cpus, "none" without cpufreq (e.g. on VMs).
+std::string getGovernor() {
+  std::set<std::string> governors;
+  for (unsigned cpu = 0; cpu < std::thread::hardware_concurrency(); cpu++) {
+    auto governor = readLine("/sys/devices/system/cpu/cpu" +
+                             std::to_string(cpu) + "/cpufreq/scaling_governor");
+    if (!governor.empty()) governors.insert(governor);
+  }
+  if (governors.empty()) return "none";
+  std::string s;
+  for (auto& governor : governors) s += (s.empty() ? "" : ",") + governor;
+  return s;
+}
+
+std::string getTurbo() {
+  auto noTurbo = readLine("/sys/devices/system/cpu/intel_pstate/no_turbo");
+  if (!noTurbo.empty()) return noTurbo == "0" ? "on" : "off";
+  auto boost = readLine("/sys/devices/system/cpu/cpufreq/boost");
+  if (!boost.empty()) return boost == "1" ? "on" : "off";
+  return "unknown";
+}
+
+std::string getSmt() {
+  auto active = readLine("/sys/devices/system/cpu/smt/active");
+  if (active.empty()) return "unknown";
+  return active == "1" ? "on" : "off";
+}
+
+std::string getKernel() {
+  utsname name;
+  if (::uname(&name) != 0) return "unknown";
+  return name.release;
+}
+
+// E.g. "0-3,8".
+std::string formatCpuList(const std::vector<std::size_t>& cpus) {
+  std::string list;
+  for (std::size_t k = 0; k < cpus.size();) {
+    auto end = k + 1;
+    while (end < cpus.size() && cpus[end] == cpus[end - 1] + 1) end++;
+    if (!list.empty()) list += ",";
+    list += std::to_string(cpus[k]);
+    if (end - k > 1) list += "-" + std::to_string(cpus[end - 1]);
+    k = end;
+  }
+  return list;
+}
+
+std::string toJsonString(const std::string& s) {
+  std::string json = "\"";
+  for (auto c : s) {
+    if (c == '"' || c == '\\') json += '\\';
+    json += c;
+  }
+  return json + "\"";
+}
+
+}  // namespace
+
+HostFingerprint getHostFingerprint() {
+  return HostFingerprint{
+      {"cpu_model", getCpuModel()},
+      {"num_cpus", std::to_string(std::thread::hardware_concurrency())},
+      {"caches", getCaches()},
+      {"governor", getGovernor()},
+      {"turbo", getTurbo()},
+      {"smt", getSmt()},
+      {"kernel", getKernel()},
+      {"placement", getPlacementName(getBenchPlacement())},
+      {"cpus", formatCpuList(getBenchCpus())},
+#if defined(__OPTIMIZE__)
+      {"optimized", "true"},
+#else
+      {"optimized", "false"},
+#endif
+  };
+}
+
+HostFingerprintReporter::HostFingerprintReporter(
+    std::unique_ptr<benchmark::BenchmarkReporter> reporter, bool json)
+    : reporter_{std::move(reporter)}, json_{json} {}
+
+bool HostFingerprintReporter::ReportContext(const Context& context) {
+  auto fingerprint = getHostFingerprint();
+  reporter_->SetErrorStream(&GetErrorStream());
+
+  if (!json_) {
+    reporter_->SetOutputStream(&GetOutputStream());
+    auto& err = GetErrorStream();
+    err << "Host:";
+    for (auto& field : fingerprint)
+      err << (&field == &fingerprint[0] ? " " : ", ") << field.first << "="
+          << field.second;
+    err << "\n";
+    return reporter_->ReportContext(context);
+  }
+
+  // The JSON reporter writes the context in one go, splice the fingerprint in
+  // as the first member of the "context" object.
+  std::ostringstream buf;
+  reporter_->SetOutputStream(&buf);
+  auto ok = reporter_->ReportContext(context);
+  reporter_->SetOutputStream(&GetOutputStream());
+
+  std::string host = "    \"bits_host\": {";
+  for (auto& field : fingerprint) {
+    host += (&field == &fingerprint[0] ? "\n" : ",\n");
+    host += "      " + toJsonString(field.first) + ": " +
+            toJsonString(field.second);
+  }
+  host += "\n    },\n";
+
+  auto s = buf.str();
+  const std::string kContext = "\"context\": {\n";
+  auto pos = s.find(kContext);
+  if (pos != std::string::npos) s.insert(pos + kContext.size(), host);
+  GetOutputStream() << s;
+  return ok;
+}
+
+void HostFingerprintReporter::ReportRuns(const std::vector<Run>& runs) {
+  reporter_->ReportRuns(runs);
+}
+
+void HostFingerprintReporter::Finalize() { reporter_->Finalize(); }
+
+}  // namespace bits
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+namespace bits {
+
+// Properties of the host which affect benchmark results, as (key, value)
+// pairs: cpu model, caches, frequency governor, turbo, SMT, kernel, whether
+// the benchmarks were built with optimizations and where benchmark threads run
+// (see environment.hpp). Results from hosts with different fingerprints are
+// not comparable.
+using HostFingerprint = std::vector<std::pair<std::string, std::string>>;
+
+HostFingerprint getHostFingerprint();
+
+// Forwards to another reporter and adds the host fingerprint to the context:
+// as a "bits_host" object in the JSON context or as a line on the console.
+class HostFingerprintReporter : public benchmark::BenchmarkReporter {
+ public:
+  HostFingerprintReporter(
+      std::unique_ptr<benchmark::BenchmarkReporter> reporter, bool json);
+
+  bool ReportContext(const Context& context) override;
+  void ReportRuns(const std::vector<Run>& runs) override;
+  void Finalize() override;
+
+ private:
+  std::unique_ptr<benchmark::BenchmarkReporter> reporter_;
+  const bool json_;
+};
+
+}  // namespace bits
@@ -1,6 +1,106 @@
+#include <unistd.h>
+
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
 #include <benchmark/benchmark.h>
 
+#include "environment.hpp"
+#include "host_fingerprint.hpp"
+#include "perf_counters.hpp"
+
+namespace {
+
+// Returns the value of --name=value or defaultValue. Must be called before
+// benchmark::Initialize(...) which removes the flags it knows from argv.
+std::string getFlag(int argc, char** argv, const std::string& name,
+                    const std::string& defaultValue) {
+  auto prefix = "--" + name + "=";
+  for (auto k = 1; k < argc; k++) {
+    if (std::strncmp(argv[k], prefix.c_str(), prefix.size()) == 0)
+      return argv[k] + prefix.size();
+  }
+  return defaultValue;
+}
+
+// Only console and json, the csv reporter is deprecated by google benchmark.
+bool isSupportedFormat(const std::string& format) {
+  return format == "console" || format == "json";
+}
+
+// Results are tagged with the host fingerprint so bin/benchcompare.cpp can
+// tell if they are comparable.
+std::unique_ptr<benchmark::BenchmarkReporter> createReporter(
+    const std::string& format) {
+  std::unique_ptr<benchmark::BenchmarkReporter> reporter;
+  if (format == "json") {
+    reporter.reset(new benchmark::JSONReporter{});
+  } else {
+    // Tabular so the perf counters line up in columns.
+    reporter.reset(new benchmark::ConsoleReporter{
+        ::isatty(STDOUT_FILENO) ? benchmark::ConsoleReporter::OO_ColorTabular
+                                : benchmark::ConsoleReporter::OO_Tabular});
+  }
+  return std::unique_ptr<benchmark::BenchmarkReporter>{
+      new bits::HostFingerprintReporter{std::move(reporter),
+                                        format == "json"}};
+}
+
+}  // namespace
+
 int main(int argc, char** argv) {
+  // Opened before google benchmark starts any threads so the counters are
+  // inherited by them.
+  bits::PerfCounters counters;
+  if (!counters.getUnavailable().empty()) {
+    std::cerr << "Perf counters unavailable:";
+    for (auto& name : counters.getUnavailable()) std::cerr << " " << name;
+    std::cerr << " (see /proc/sys/kernel/perf_event_paranoid)" << std::endl;
+  }
+
+  auto format = getFlag(argc, argv, "benchmark_format", "console");
+  auto out = getFlag(argc, argv, "benchmark_out", "");
+  auto outFormat = getFlag(argc, argv, "benchmark_out_format", "json");
+
+  for (auto& f : {format, outFormat}) {
+    if (!isSupportedFormat(f)) {
+      std::cerr << "Unsupported format " << f
+                << ", only console and json are supported" << std::endl;
+      return 1;
+    }
+  }
+
+  auto placement = getFlag(argc, argv, "bits_placement", "none");
+  auto isolated = getFlag(argc, argv, "bits_isolated", "false") == "true";
+
   benchmark::Initialize(&argc, argv);
-  benchmark::RunSpecifiedBenchmarks();
+
+  try {
+    if (!bits::configureBenchEnvironment(bits::parsePlacement(placement),
+                                         isolated)) {
+      std::cerr << "***WARNING*** No isolated cpus available, ignoring "
+                   "--bits_isolated"
+                << std::endl;
+    }
+  } catch (const std::invalid_argument& e) {
+    std::cerr << e.what() << ", use --bits_placement=none|cores|compact|scatter"
+              << std::endl;
+    return 1;
+  }
+  for (auto& warning :
+       bits::checkBenchEnvironment(bits::getHostFingerprint())) {
+    std::cerr << "***WARNING*** " << warning << std::endl;
+  }
+
+  bits::PerfCountersReporter display{createReporter(format), counters, true};
+  if (out.empty()) {
+    benchmark::RunSpecifiedBenchmarks(&display);
+  } else {
+    bits::PerfCountersReporter file{createReporter(outFormat), counters, false};
+    benchmark::RunSpecifiedBenchmarks(&display, &file);
+  }
 }
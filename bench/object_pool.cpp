@@ -0,0 +1,84 @@
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include <benchmark/benchmark.h>
+
+#include <bits/object_pool.hpp>
+#include <bits/spsc_queue.hpp>
+
+#include "environment.hpp"
+
+namespace bits {
+namespace {
+
+constexpr auto N = 10'000;
+constexpr std::size_t kMaxThreads = 16;
+constexpr std::size_t kQueueCapacity = 1024;
+
+struct Object {
+  std::array<std::uint64_t, 8> data;
+};
+
+struct NewDelete {
+  static Object* create() { return new Object{}; }
+  static void destroy(Object* p) { delete p; }
+};
+
+struct Pool {
+  static Object* create() { return ObjectPool<Object>::create(); }
+  static void destroy(Object* p) { ObjectPool<Object>::destroy(p); }
+};
+
+struct Queue : public SpscQueue<Object*> {
+  Queue() : SpscQueue<Object*>{kQueueCapacity} {}
+};
+
+// Thread k hands the objects it allocates to thread k + 1 (mod the number of
+// threads) through queue k + 1.
+template <typename A>
+std::array<Queue, kMaxThreads>& getQueues() {
+  static std::array<Queue, kMaxThreads> queues;
+  return queues;
+}
+
+template <typename A>
+void benchObjectPool(benchmark::State& state) {
+  auto pin = pinBenchThread(state);
+  auto& queues = getQueues<A>();
+  auto index = static_cast<std::size_t>(state.thread_index);
+  auto& in = queues[index];
+  auto& out = queues[(index + 1) % static_cast<std::size_t>(state.threads)];
+
+  while (state.KeepRunningBatch(N)) {
+    for (auto k = 0; k < N; k++) {
+      auto p = A::create();
+      p->data[0] = static_cast<std::uint64_t>(k);
+      benchmark::DoNotOptimize(p);
+      if (!out.tryPush(p)) A::destroy(p);
+
+      Object* q;
+      if (in.tryPop(q)) A::destroy(q);
+    }
+  }
+
+  // All threads have left the loop (there's a barrier at the end of a run) so
+  // nothing is pushed anymore.
+  Object* q;
+  while (in.tryPop(q)) A::destroy(q);
+}
+
+// Time per allocation + free of a 64 byte object where (almost) every object
+// is freed by a different thread than the one that allocated it. With one
+// thread the object is freed by the allocating thread.
+//
+// glibc malloc has per-thread caches (tcache) too, but frees of memory
+// allocated by another thread go back to that thread's arena under its lock.
+// The pool only exchanges whole magazines of 64 objects with a lock-free
+// depot, so it should stay at a few ns per pair as the number of threads
+// grows while new/delete slows down.
+BENCHMARK_TEMPLATE(benchObjectPool, NewDelete)->ThreadRange(1, 16);
+BENCHMARK_TEMPLATE(benchObjectPool, Pool)->ThreadRange(1, 16);
+
+}  // namespace
+}  // namespace bits
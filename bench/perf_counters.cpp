@@ -0,0 +1,149 @@
+#include "perf_counters.hpp"
+
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+
+namespace bits {
+namespace {
+
+struct Event {
+  const char* name;
+  std::uint32_t type;
+  std::uint64_t config;
+};
+
+constexpr std::uint64_t cacheEvent(std::uint64_t cache, std::uint64_t op,
+                                   std::uint64_t result) {
+  return cache | (op << 8) | (result << 16);
+}
+
+// Names follow perf list. More hardware events than the cpu has counters
+// are multiplexed and scaled, which makes them less precise.
+const Event kEvents[] = {
+    {"cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {"instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {"branches", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_INSTRUCTIONS},
+    {"branch-misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+    {"cache-references", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_REFERENCES},
+    {"L1-dcache-load-misses", PERF_TYPE_HW_CACHE,
+     cacheEvent(PERF_COUNT_HW_CACHE_L1D, PERF_COUNT_HW_CACHE_OP_READ,
+                PERF_COUNT_HW_CACHE_RESULT_MISS)},
+    {"LLC-load-misses", PERF_TYPE_HW_CACHE,
+     cacheEvent(PERF_COUNT_HW_CACHE_LL, PERF_COUNT_HW_CACHE_OP_READ,
+                PERF_COUNT_HW_CACHE_RESULT_MISS)},
+    {"page-faults", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS},
+    {"context-switches", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES},
+};
+
+int openEvent(std::uint32_t type, std::uint64_t config) {
+  perf_event_attr attr;
+  std::memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = type;
+  attr.config = config;
+  attr.inherit = 1;
+  attr.exclude_hv = 1;
+  attr.read_format =
+      PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+  auto fd = ::syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+  if (fd < 0 && (errno == EACCES || errno == EPERM)) {
+    attr.exclude_kernel = 1;
+    fd = ::syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+  }
+  return static_cast<int>(fd);
+}
+
+// Returns the count scaled up for the time the counter was multiplexed out.
+double readEvent(int fd) {
+  std::uint64_t values[3];
+  if (::read(fd, values, sizeof(values)) != sizeof(values) || values[2] == 0)
+    return 0;
+  return static_cast<double>(values[0]) * static_cast<double>(values[1]) /
+         static_cast<double>(values[2]);
+}
+
+}  // namespace
+
+PerfCounters::PerfCounters() {
+  taskClock_ = openEvent(PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK);
+  for (auto& event : kEvents) {
+    auto fd = taskClock_ < 0 ? -1 : openEvent(event.type, event.config);
+    if (fd < 0) {
+      unavailable_.push_back(event.name);
+    } else {
+      counters_.push_back(Counter{event.name, fd});
+    }
+  }
+  last_ = read();
+  delta_.assign(last_.size(), 0);
+}
+
+PerfCounters::~PerfCounters() {
+  for (auto& counter : counters_) ::close(counter.fd);
+  if (taskClock_ >= 0) ::close(taskClock_);
+}
+
+void PerfCounters::sample() {
+  auto values = read();
+  for (std::size_t k = 0; k < values.size(); k++) {
+    delta_[k] = values[k] - last_[k];
+  }
+  last_ = values;
+}
+
+void PerfCounters::annotate(
+    std::vector<benchmark::BenchmarkReporter::Run>& runs) const {
+  if (counters_.empty() || delta_[0] <= 0) return;
+
+  for (auto& run : runs) {
+    // Other aggregates (e.g. stddev) aren't per iteration.
+    if (run.error_occurred || run.iterations == 0 ||
+        !(run.aggregate_name.empty() || run.aggregate_name == "mean" ||
+          run.aggregate_name == "median")) {
+      continue;
+    }
+    auto cpuNsPerIteration = run.cpu_accumulated_time * 1e9 /
+                             static_cast<double>(run.iterations);
+    for (std::size_t k = 0; k < counters_.size(); k++) {
+      run.counters[counters_[k].name] =
+          delta_[k + 1] / delta_[0] * cpuNsPerIteration;
+    }
+  }
+}
+
+std::vector<double> PerfCounters::read() const {
+  std::vector<double> values;
+  if (taskClock_ < 0) return values;
+  values.push_back(readEvent(taskClock_));
+  for (auto& counter : counters_) values.push_back(readEvent(counter.fd));
+  return values;
+}
+
+PerfCountersReporter::PerfCountersReporter(
+    std::unique_ptr<benchmark::BenchmarkReporter> reporter,
+    PerfCounters& counters, bool sample)
+    : reporter_{std::move(reporter)}, counters_{counters}, sample_{sample} {}
+
+bool PerfCountersReporter::ReportContext(const Context& context) {
+  // google benchmark points the streams of this reporter at the output file
+  // (if any) before reporting anything.
+  reporter_->SetOutputStream(&GetOutputStream());
+  reporter_->SetErrorStream(&GetErrorStream());
+  return reporter_->ReportContext(context);
+}
+
+void PerfCountersReporter::ReportRuns(const std::vector<Run>& runs) {
+  if (sample_) counters_.sample();
+  auto annotated = runs;
+  counters_.annotate(annotated);
+  reporter_->ReportRuns(annotated);
+}
+
+void PerfCountersReporter::Finalize() { reporter_->Finalize(); }
+
+}  // namespace bits
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+namespace bits {
+
+// Hardware (and a few software) performance counters of the whole process via
+// perf_event_open(...), the same events perf stat counts. Counters are opened
+// with inherit so they also count threads started later, e.g. the threads of
+// multi-threaded benchmarks, and MUST be created before any threads.
+//
+// Counters which can't be opened are skipped, e.g. when
+// /proc/sys/kernel/perf_event_paranoid forbids them or on VMs without a
+// virtual PMU. Kernel events are excluded if only user space may be counted.
+class PerfCounters {
+ public:
+  PerfCounters();
+
+  PerfCounters(const PerfCounters&) = delete;
+  PerfCounters& operator=(const PerfCounters&) = delete;
+
+  ~PerfCounters();
+
+  // Names of the counters which could not be opened.
+  const std::vector<std::string>& getUnavailable() const {
+    return unavailable_;
+  }
+
+  // Takes a new sample. annotate(...) attributes the counts since the previous
+  // sample.
+  void sample();
+
+  // Adds the counts per iteration to runs.
+  //
+  // Counters run all the time so the counts between two samples include runs
+  // google benchmark makes to find the number of iterations and the ones which
+  // are reported. The counts are attributed to a run by its share of the cpu
+  // time (task-clock) since the last sample, which is exact as long as every
+  // run of a benchmark does the same work per iteration. Counts of threads
+  // which are not part of the benchmark (e.g. pool workers) are included but
+  // their cpu time isn't, so counts per iteration are inflated accordingly.
+  void annotate(std::vector<benchmark::BenchmarkReporter::Run>& runs) const;
+
+ private:
+  struct Counter {
+    std::string name;
+    int fd;
+  };
+
+  std::vector<double> read() const;
+
+  int taskClock_ = -1;
+  std::vector<Counter> counters_;
+  std::vector<std::string> unavailable_;
+  std::vector<double> last_;
+  std::vector<double> delta_;
+};
+
+// Forwards to another reporter after adding perf counters to the runs. Only
+// one reporter per PerfCounters should sample, the others reuse its sample.
+class PerfCountersReporter : public benchmark::BenchmarkReporter {
+ public:
+  PerfCountersReporter(std::unique_ptr<benchmark::BenchmarkReporter> reporter,
+                       PerfCounters& counters, bool sample);
+
+  bool ReportContext(const Context& context) override;
+  void ReportRuns(const std::vector<Run>& runs) override;
+  void Finalize() override;
+
+ private:
+  std::unique_ptr<benchmark::BenchmarkReporter> reporter_;
+  PerfCounters& counters_;
+  const bool sample_;
+};
+
+}  // namespace bits
@@ -0,0 +1,252 @@
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+#include <boost/optional.hpp>
+
+#include <bits/affinity.hpp>
+#include <bits/cpu_topology.hpp>
+#include <bits/mpsc_queue.hpp>
+#include <bits/spsc_queue.hpp>
+
+namespace bits {
+namespace {
+
+constexpr std::size_t kCapacity = 1024;
+constexpr std::uint64_t kItems = 1'000'000;
+constexpr std::uint64_t kRoundTrips = 100'000;
+
+// Where the producer and consumer threads run relative to each other.
+enum class Distance { kSiblings, kSamePackage, kCrossPackage };
+
+// Returns a pair of cpus at the distance or boost::none if there isn't one.
+boost::optional<std::pair<std::size_t, std::size_t>> getCpuPair(
+    Distance distance) {
+  const auto& cpus = CpuTopology::get().cpus();
+  for (const auto& lhs : cpus) {
+    for (const auto& rhs : cpus) {
+      if (lhs.cpu == rhs.cpu) continue;
+      auto siblings = lhs.core == rhs.core;
+      auto samePackage = lhs.package == rhs.package;
+      if ((distance == Distance::kSiblings && siblings) ||
+          (distance == Distance::kSamePackage && samePackage && !siblings) ||
+          (distance == Distance::kCrossPackage && !samePackage))
+        return std::make_pair(lhs.cpu, rhs.cpu);
+    }
+  }
+  return boost::none;
+}
+
+// The mutex protected std::deque our pipeline stages use today, bounded the
+// same way as the lock-free queues.
+class MutexQueue {
+ public:
+  explicit MutexQueue(std::size_t capacity) : capacity_{capacity} {}
+
+  template <typename It>
+  std::size_t tryPushBatch(It first, It last) {
+    std::lock_guard<std::mutex> lock{mutex_};
+    auto n = std::min(static_cast<std::size_t>(last - first),
+                      capacity_ - items_.size());
+    items_.insert(items_.end(), first, first + n);
+    return n;
+  }
+
+  template <typename OutIt>
+  std::size_t tryPopBatch(OutIt out, std::size_t max) {
+    std::lock_guard<std::mutex> lock{mutex_};
+    auto n = std::min(max, items_.size());
+    std::copy(items_.begin(), items_.begin() + n, out);
+    items_.erase(items_.begin(), items_.begin() + n);
+    return n;
+  }
+
+ private:
+  const std::size_t capacity_;
+  std::mutex mutex_;
+  std::deque<std::uint64_t> items_;
+};
+
+template <typename Q>
+void push(Q& queue, const std::uint64_t* first, const std::uint64_t* last) {
+  while (first < last) first += queue.tryPushBatch(first, last);
+}
+
+template <typename Q>
+void pop(Q& queue, std::uint64_t* first, std::size_t n) {
+  while (n > 0) {
+    auto popped = queue.tryPopBatch(first, n);
+    first += popped;
+    n -= popped;
+  }
+}
+
+// Pins the two threads of one benchmark iteration. Exceptions can't leave a
+// std::thread so pin failures are kept and rethrown after the join, and a
+// thread whose peer failed to pin returns instead of waiting for it forever.
+class PinnedPair {
+ public:
+  // Returns false if either thread failed to pin itself.
+  bool pinAndWait(std::size_t k, std::size_t cpu) {
+    try {
+      pinThisThread(cpu);
+    } catch (...) {
+      errors_[k] = std::current_exception();
+    }
+    ready_.fetch_add(1);
+    while (ready_.load() < 2) {
+    }
+    return !errors_[0] && !errors_[1];
+  }
+
+  // Skips the benchmark with the first pin failure, returns false if there
+  // was one.
+  bool check(benchmark::State& state) const {
+    for (auto& error : errors_) {
+      if (!error) continue;
+      try {
+        std::rethrow_exception(error);
+      } catch (const std::exception& e) {
+        state.SkipWithError(e.what());
+      } catch (...) {
+        state.SkipWithError("Failed to pin a thread.");
+      }
+      return false;
+    }
+    return true;
+  }
+
+ private:
+  std::atomic<int> ready_{0};
+  std::exception_ptr errors_[2];
+};
+
+template <typename Q>
+void benchQueueThroughput(benchmark::State& state) {
+  auto cpus = getCpuPair(static_cast<Distance>(state.range(0)));
+  if (!cpus) {
+    state.SkipWithError("No pair of cpus at this distance.");
+    return;
+  }
+  auto batch = static_cast<std::size_t>(state.range(1));
+
+  Q queue{kCapacity};
+  while (state.KeepRunningBatch(kItems)) {
+    PinnedPair pair;
+    std::thread producer{[&queue, &pair, &cpus, batch]() {
+      if (!pair.pinAndWait(0, cpus->first)) return;
+      std::vector<std::uint64_t> items(batch);
+      for (std::uint64_t k = 0; k < kItems; k += batch) {
+        auto n = std::min<std::uint64_t>(batch, kItems - k);
+        for (std::size_t i = 0; i < n; i++) items[i] = k + i;
+        push(queue, items.data(), items.data() + n);
+      }
+    }};
+
+    std::thread consumer{[&queue, &pair, &cpus, batch]() {
+      if (!pair.pinAndWait(1, cpus->second)) return;
+      std::vector<std::uint64_t> items(batch);
+      for (std::uint64_t k = 0; k < kItems; k += batch) {
+        auto n = std::min<std::uint64_t>(batch, kItems - k);
+        pop(queue, items.data(), n);
+        benchmark::DoNotOptimize(items.data());
+      }
+    }};
+
+    producer.join();
+    consumer.join();
+    if (!pair.check(state)) break;
+  }
+
+  state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations()));
+}
+
+// Each iteration is a round trip: the ping thread pushes to one queue and the
+// pong thread echoes the item back through another.
+template <typename Q>
+void benchQueueLatency(benchmark::State& state) {
+  auto cpus = getCpuPair(static_cast<Distance>(state.range(0)));
+  if (!cpus) {
+    state.SkipWithError("No pair of cpus at this distance.");
+    return;
+  }
+
+  Q ping{kCapacity};
+  Q pong{kCapacity};
+  while (state.KeepRunningBatch(kRoundTrips)) {
+    PinnedPair pair;
+    std::thread echo{[&ping, &pong, &pair, &cpus]() {
+      if (!pair.pinAndWait(1, cpus->second)) return;
+      std::uint64_t x;
+      for (std::uint64_t k = 0; k < kRoundTrips; k++) {
+        pop(ping, &x, 1);
+        push(pong, &x, &x + 1);
+      }
+    }};
+
+    std::thread send{[&ping, &pong, &pair, &cpus]() {
+      if (!pair.pinAndWait(0, cpus->first)) return;
+      for (std::uint64_t k = 0; k < kRoundTrips; k++) {
+        std::uint64_t x = k;
+        push(ping, &x, &x + 1);
+        pop(pong, &x, 1);
+      }
+    }};
+
+    send.join();
+    echo.join();
+    if (!pair.check(state)) break;
+  }
+}
+
+void throughputArgs(benchmark::internal::Benchmark* b) {
+  for (auto distance : {Distance::kSiblings, Distance::kSamePackage,
+                        Distance::kCrossPackage}) {
+    for (auto batch : {1, 16})
+      b->Args({static_cast<int>(distance), batch});
+  }
+  b->UseRealTime();
+}
+
+void latencyArgs(benchmark::internal::Benchmark* b) {
+  for (auto distance : {Distance::kSiblings, Distance::kSamePackage,
+                        Distance::kCrossPackage})
+    b->Arg(static_cast<int>(distance));
+  b->UseRealTime();
+}
+
+// Throughput of handing 8 byte items from a producer to a consumer thread. The
+// first argument is the distance between the threads (0 = SMT siblings, 1 =
+// cores on the same package, 2 = cores on different packages) and the second
+// argument is the batch size. Distances not present on the machine are
+// skipped.
+//
+// Siblings share the L1 so the cache lines of the queue never leave the core.
+// Across cores every transfer of a cache line goes through the L3 and across
+// packages through the interconnect which is where avoiding coherence traffic
+// (cached indexes, batching) pays off the most. The mutex protected deque
+// bounces the lock, the deque's internals and the items between the threads.
+BENCHMARK_TEMPLATE(benchQueueThroughput, SpscQueue<std::uint64_t>)
+    ->Apply(throughputArgs);
+BENCHMARK_TEMPLATE(benchQueueThroughput, MpscQueue<std::uint64_t>)
+    ->Apply(throughputArgs);
+BENCHMARK_TEMPLATE(benchQueueThroughput, MutexQueue)->Apply(throughputArgs);
+
+// Round trip latency of a single item, the one-way latency is half the time
+// per iteration. Argument is the distance as above.
+BENCHMARK_TEMPLATE(benchQueueLatency, SpscQueue<std::uint64_t>)
+    ->Apply(latencyArgs);
+BENCHMARK_TEMPLATE(benchQueueLatency, MpscQueue<std::uint64_t>)
+    ->Apply(latencyArgs);
+BENCHMARK_TEMPLATE(benchQueueLatency, MutexQueue)->Apply(latencyArgs);
+
+}  // namespace
+}  // namespace bits
@@ -0,0 +1,67 @@
+#include <cstdint>
+#include <mutex>
+
+#include <benchmark/benchmark.h>
+
+#include <bits/spinlock.hpp>
+
+#include "environment.hpp"
+
+namespace bits {
+namespace {
+
+constexpr auto N = 10'000;
+
+// Shared data written in the critical section. On its own cache line so the
+// results don't depend on whether it shares a line with a lock.
+CachePadded<std::uint64_t> shared{0};
+
+template <typename L>
+L& getLock() {
+  static L lock;
+  return lock;
+}
+
+template <typename L>
+void benchSpinlock(benchmark::State& state) {
+  auto pin = pinBenchThread(state);
+  auto& lock = getLock<L>();
+  auto criticalSection = state.range(0);
+
+  while (state.KeepRunningBatch(N)) {
+    for (auto k = 0; k < N; k++) {
+      std::lock_guard<L> guard{lock};
+      for (auto i = 0; i < criticalSection; i++) {
+        (*shared)++;
+        benchmark::ClobberMemory();
+      }
+    }
+  }
+}
+
+void spinlockArgs(benchmark::internal::Benchmark* b) {
+  b->Arg(0)->Arg(10)->Arg(100)->Arg(1000)->ThreadRange(1, 16)->UseRealTime();
+}
+
+// Time per acquire + release (+ critical section) of a single lock shared by
+// all threads. The argument is the length of the critical section in
+// increments of shared data.
+//
+// With one thread this is the uncontended cost of the atomic RMW (or two for
+// MCS, one of which is a CAS). Under contention with short critical sections
+// the cost is dominated by moving cache lines between cores: TAS hammers the
+// lock's line with RFOs even while it is held, TTAS and ticket locks make all
+// waiters re-read the line on every release and the queue locks only hand a
+// single line to the next waiter. std::mutex puts waiters to sleep in the
+// kernel (futex) which is slow for short critical sections but wins when
+// threads outnumber cpus: spinning waiters then burn the time slices the
+// lock holder needs, and the FIFO locks hand the lock to preempted waiters.
+BENCHMARK_TEMPLATE(benchSpinlock, TasLock)->Apply(spinlockArgs);
+BENCHMARK_TEMPLATE(benchSpinlock, TtasLock)->Apply(spinlockArgs);
+BENCHMARK_TEMPLATE(benchSpinlock, TicketLock)->Apply(spinlockArgs);
+BENCHMARK_TEMPLATE(benchSpinlock, McsLock)->Apply(spinlockArgs);
+BENCHMARK_TEMPLATE(benchSpinlock, ClhLock)->Apply(spinlockArgs);
+BENCHMARK_TEMPLATE(benchSpinlock, std::mutex)->Apply(spinlockArgs);
+
+}  // namespace
+}  // namespace bits
@@ -2,6 +2,8 @@
 
 #include <benchmark/benchmark.h>
 
+#include <bits/thread_local.hpp>
+
 namespace bits {
 namespace {
 
@@ -19,6 +21,20 @@ void benchStaticsThreadLocal(benchmark::State& state) {
   }
 }
 
+template <void* (*F)()>
+void benchStaticsTLSModel(benchmark::State& state) {
+  while (state.KeepRunningBatch(N)) {
+    for (auto k = 0; k < N; k++) benchmark::DoNotOptimize(F());
+  }
+}
+
+void benchStaticsThreadLocalObject(benchmark::State& state) {
+  ThreadLocal<char> tl;
+  while (state.KeepRunningBatch(N)) {
+    for (auto k = 0; k < N; k++) benchmark::DoNotOptimize(tl.get());
+  }
+}
+
 // This benchmarks demonstrates the performance differences between (1) static
 // storage and (2) thread local static storage. The performance of TLS on Linux
 // is highly dependent on compiler options used, particularly if the library
@@ -73,8 +89,34 @@ void benchStaticsThreadLocal(benchmark::State& state) {
 // Also, I've ran these benchmarks on macOS and see similar results for shared
 // libraries. However, TLS with static libraries cannot seem to match non-TLS. I
 // haven't figured out why yet because macOS doesn't support perf :(
+//
+// benchStaticsThreadLocalObject measures ThreadLocal<T>::get() inlined into a
+// loop. The compiler computes the address of the per-thread value array (a
+// TLS access defined in libbits) once outside of the loop, so this only
+// measures the load of the array, the bounds check and the indexed load and
+// comes out faster than any of the TLS accesses through a function call. Code
+// calling get() once per function call pays for the TLS access too.
+//
+// benchStaticsTLSModel<...> runs the same getter from libraries built with each
+// TLS model regardless of how libbits was configured (-Dtls_model and
+// -Dtls_dialect pick the model of benchStaticsThreadLocal). Shared libraries:
+// global-dynamic calls __tls_get_addr on every access, TLS descriptors
+// (-mtls-dialect=gnu2) replace it with an indirect call to a resolver which
+// for libraries loaded at startup just returns a constant offset and
+// initial-exec is a single load of the offset from the GOT. Static libraries
+// end up in the executable where the linker relaxes the access to local-exec,
+// a constant offset from %fs, so getTLStatic and getTLLocalExec should match
+// benchStaticsShared.
 BENCHMARK(benchStaticsShared);
 BENCHMARK(benchStaticsThreadLocal);
+BENCHMARK_TEMPLATE(benchStaticsTLSModel, &Statics::getTLGlobalDynamic);
+#ifdef BITS_TLS_DESCRIPTORS
+BENCHMARK_TEMPLATE(benchStaticsTLSModel, &Statics::getTLDescriptors);
+#endif
+BENCHMARK_TEMPLATE(benchStaticsTLSModel, &Statics::getTLInitialExec);
+BENCHMARK_TEMPLATE(benchStaticsTLSModel, &Statics::getTLStatic);
+BENCHMARK_TEMPLATE(benchStaticsTLSModel, &Statics::getTLLocalExec);
+BENCHMARK(benchStaticsThreadLocalObject);
 
 }  // namespace
 }  // namespace bits
@@ -1,11 +1,38 @@
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <time.h>
 #include <unistd.h>
 
+#if defined(__has_include)
+#if __has_include(<linux/io_uring.h>) && defined(__NR_io_uring_setup)
+#include <linux/io_uring.h>
+#define BITS_HAVE_IO_URING
+#endif
+#if __has_include(<linux/membarrier.h>) && defined(__NR_membarrier)
+#include <linux/membarrier.h>
+#define BITS_HAVE_MEMBARRIER
+#endif
+#endif
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
 #include <benchmark/benchmark.h>
 
 namespace bits {
 namespace {
 
 constexpr auto N = 1'000;
+constexpr std::size_t kIoSize = 64;
+constexpr unsigned kMaxBatch = 64;
 
 // We can see syscalls being made via perf stat -e "syscalls:sys_enter_getpid"
 // ...
@@ -74,5 +101,360 @@ void benchSysCall(benchmark::State& state) {
 
 BENCHMARK(benchSysCall);
 
+struct VdsoMonotonic {
+  static int call(timespec* ts) { return ::clock_gettime(CLOCK_MONOTONIC, ts); }
+};
+
+struct VdsoMonotonicCoarse {
+  static int call(timespec* ts) {
+    return ::clock_gettime(CLOCK_MONOTONIC_COARSE, ts);
+  }
+};
+
+// Bypasses the vDSO.
+struct SysCallMonotonic {
+  static int call(timespec* ts) {
+    return static_cast<int>(::syscall(SYS_clock_gettime, CLOCK_MONOTONIC, ts));
+  }
+};
+
+// Not implemented by the vDSO so this is always a syscall.
+struct ProcessCpuTime {
+  static int call(timespec* ts) {
+    return ::clock_gettime(CLOCK_PROCESS_CPUTIME_ID, ts);
+  }
+};
+
+template <typename C>
+void benchClockGettime(benchmark::State& state) {
+  timespec ts;
+  while (state.KeepRunningBatch(N)) {
+    for (auto k = 0; k < N; k++) {
+      benchmark::DoNotOptimize(C::call(&ts));
+      benchmark::ClobberMemory();
+    }
+  }
+}
+
+long futex(std::atomic<std::uint32_t>* addr, int op, std::uint32_t val) {
+  return ::syscall(SYS_futex, reinterpret_cast<std::uint32_t*>(addr),
+                   op | FUTEX_PRIVATE_FLAG, val, nullptr, nullptr, 0);
+}
+
+// Waking a futex nobody waits on: the cost of entering the kernel and hashing
+// the futex address.
+void benchFutexWake(benchmark::State& state) {
+  std::atomic<std::uint32_t> word{0};
+  while (state.KeepRunningBatch(N)) {
+    for (auto k = 0; k < N; k++)
+      benchmark::DoNotOptimize(futex(&word, FUTEX_WAKE, 1));
+  }
+}
+
+// Two threads take turns: each waits for the word to become its turn, flips
+// it and wakes the other thread. One iteration is a full round trip (two
+// wait/wake pairs and context switches).
+void benchFutexPingPong(benchmark::State& state) {
+  constexpr std::uint32_t kPing = 0;
+  constexpr std::uint32_t kPong = 1;
+  constexpr std::uint32_t kStop = 2;
+
+  std::atomic<std::uint32_t> word{kPing};
+  std::thread ponger{[&word]() {
+    while (true) {
+      auto v = word.load();
+      if (v == kStop) return;
+      if (v == kPing) {
+        futex(&word, FUTEX_WAIT, kPing);
+        continue;
+      }
+      word.store(kPing);
+      futex(&word, FUTEX_WAKE, 1);
+    }
+  }};
+
+  while (state.KeepRunning()) {
+    word.store(kPong);
+    futex(&word, FUTEX_WAKE, 1);
+    while (word.load() == kPong) futex(&word, FUTEX_WAIT, kPong);
+  }
+
+  word.store(kStop);
+  futex(&word, FUTEX_WAKE, 1);
+  ponger.join();
+}
+
+void benchSchedYield(benchmark::State& state) {
+  while (state.KeepRunningBatch(N)) {
+    for (auto k = 0; k < N; k++) benchmark::DoNotOptimize(::sched_yield());
+  }
+}
+
+#ifdef BITS_HAVE_MEMBARRIER
+long membarrier(int cmd) { return ::syscall(__NR_membarrier, cmd, 0); }
+
+// The argument is the membarrier command. Private expedited IPIs only the cpus
+// running threads of this process, global waits for an RCU grace period on
+// all cpus and is much slower.
+void benchMembarrier(benchmark::State& state) {
+  auto cmd = static_cast<int>(state.range(0));
+  auto supported = membarrier(MEMBARRIER_CMD_QUERY);
+  if (supported < 0 || !(supported & cmd)) {
+    state.SkipWithError("Membarrier command is not supported.");
+    return;
+  }
+  if (cmd == MEMBARRIER_CMD_PRIVATE_EXPEDITED &&
+      membarrier(MEMBARRIER_CMD_REGISTER_PRIVATE_EXPEDITED) != 0) {
+    state.SkipWithError("Failed to register for private expedited.");
+    return;
+  }
+
+  while (state.KeepRunning()) benchmark::DoNotOptimize(membarrier(cmd));
+}
+#endif
+
+// Reads and writes kIoSize bytes at a time from a temporary file which stays
+// in the page cache, so this is mostly syscall overhead. Operation k of a
+// batch reads and rewrites the k-th kIoSize bytes of the file.
+class FileIo {
+ public:
+  FileIo() {
+    char path[] = "/tmp/bits-syscall-XXXXXX";
+    fd_ = ::mkstemp(path);
+    if (fd_ < 0) return;
+    ::unlink(path);
+    if (::ftruncate(fd_, kMaxBatch * kIoSize) != 0) {
+      ::close(fd_);
+      fd_ = -1;
+    }
+  }
+
+  FileIo(const FileIo&) = delete;
+  FileIo& operator=(const FileIo&) = delete;
+
+  ~FileIo() {
+    if (fd_ >= 0) ::close(fd_);
+  }
+
+  bool ok() const { return fd_ >= 0; }
+
+ protected:
+  static off_t offset(unsigned k) { return static_cast<off_t>(k * kIoSize); }
+
+  int fd_ = -1;
+  std::array<std::array<char, kIoSize>, kMaxBatch> bufs_;
+};
+
+// A pread(...) and pwrite(...) per operation.
+class SingleIo : public FileIo {
+ public:
+  bool run(unsigned batch) {
+    for (unsigned k = 0; k < batch; k++) {
+      auto buf = bufs_[k].data();
+      if (::pread(fd_, buf, kIoSize, offset(k)) != kIoSize) return false;
+      if (::pwrite(fd_, buf, kIoSize, offset(k)) != kIoSize) return false;
+    }
+    return true;
+  }
+};
+
+// One preadv(...) and pwritev(...) per batch. The fallback when io_uring isn't
+// available: it only batches operations on contiguous ranges of one file.
+class VectoredIo : public FileIo {
+ public:
+  VectoredIo() {
+    for (unsigned k = 0; k < kMaxBatch; k++)
+      iovs_[k] = iovec{bufs_[k].data(), kIoSize};
+  }
+
+  bool run(unsigned batch) {
+    auto n = static_cast<ssize_t>(batch * kIoSize);
+    auto len = static_cast<int>(batch);
+    return ::preadv(fd_, iovs_.data(), len, 0) == n &&
+           ::pwritev(fd_, iovs_.data(), len, 0) == n;
+  }
+
+ private:
+  std::array<iovec, kMaxBatch> iovs_;
+};
+
+#ifdef BITS_HAVE_IO_URING
+// A minimal io_uring without liburing: all reads and writes of a batch are
+// queued and submitted (and waited for) with a single io_uring_enter(...).
+// Reads and writes of the same buffer are chained with IOSQE_IO_LINK.
+class UringIo : public FileIo {
+ public:
+  UringIo() {
+    io_uring_params params{};
+    ringFd_ = static_cast<int>(::syscall(__NR_io_uring_setup, 2 * kMaxBatch,
+                                     &params));
+    if (ringFd_ < 0) return;
+
+    sqLen_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cqLen_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    sqesLen_ = params.sq_entries * sizeof(io_uring_sqe);
+    sq_ = map(sqLen_, IORING_OFF_SQ_RING);
+    cq_ = map(cqLen_, IORING_OFF_CQ_RING);
+    sqes_ = static_cast<io_uring_sqe*>(map(sqesLen_, IORING_OFF_SQES));
+    if (!sq_ || !cq_ || !sqes_) return;
+
+    sqTail_ = at<unsigned>(sq_, params.sq_off.tail);
+    sqMask_ = *at<unsigned>(sq_, params.sq_off.ring_mask);
+    sqArray_ = at<unsigned>(sq_, params.sq_off.array);
+    cqHead_ = at<unsigned>(cq_, params.cq_off.head);
+    cqTail_ = at<unsigned>(cq_, params.cq_off.tail);
+    cqMask_ = *at<unsigned>(cq_, params.cq_off.ring_mask);
+    cqes_ = at<io_uring_cqe>(cq_, params.cq_off.cqes);
+
+    for (unsigned k = 0; k < kMaxBatch; k++)
+      iovs_[k] = iovec{bufs_[k].data(), kIoSize};
+    ready_ = true;
+  }
+
+  ~UringIo() {
+    if (sqes_) ::munmap(sqes_, sqesLen_);
+    if (cq_) ::munmap(cq_, cqLen_);
+    if (sq_) ::munmap(sq_, sqLen_);
+    if (ringFd_ >= 0) ::close(ringFd_);
+  }
+
+  bool ok() const { return FileIo::ok() && ready_; }
+
+  bool run(unsigned batch) {
+    auto tail = *sqTail_;
+    for (unsigned k = 0; k < batch; k++) {
+      push(tail++, IORING_OP_READV, k, IOSQE_IO_LINK);
+      push(tail++, IORING_OP_WRITEV, k, 0);
+    }
+    __atomic_store_n(sqTail_, tail, __ATOMIC_RELEASE);
+
+    auto n = 2 * batch;
+    if (::syscall(__NR_io_uring_enter, ringFd_, n, n, IORING_ENTER_GETEVENTS,
+                  nullptr, 0) != n)
+      return false;
+
+    auto head = *cqHead_;
+    auto cqTail = __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE);
+    auto ok = cqTail - head == n;
+    for (; head != cqTail; head++)
+      ok &= cqes_[head & cqMask_].res == static_cast<int>(kIoSize);
+    __atomic_store_n(cqHead_, head, __ATOMIC_RELEASE);
+    return ok;
+  }
+
+ private:
+  template <typename T>
+  static T* at(void* base, std::uint32_t offset) {
+    return reinterpret_cast<T*>(static_cast<char*>(base) + offset);
+  }
+
+  void* map(std::size_t len, off_t pgoff) {
+    auto p = ::mmap(nullptr, len, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, ringFd_, pgoff);
+    return p == MAP_FAILED ? nullptr : p;
+  }
+
+  void push(unsigned tail, std::uint8_t op, unsigned k, std::uint8_t flags) {
+    auto index = tail & sqMask_;
+    auto& sqe = sqes_[index];
+    sqe = io_uring_sqe{};
+    sqe.opcode = op;
+    sqe.flags = flags;
+    sqe.fd = fd_;
+    sqe.off = static_cast<std::uint64_t>(offset(k));
+    sqe.addr = reinterpret_cast<std::uint64_t>(&iovs_[k]);
+    sqe.len = 1;
+    sqArray_[index] = index;
+  }
+
+  int ringFd_ = -1;
+  bool ready_ = false;
+  void* sq_ = nullptr;
+  void* cq_ = nullptr;
+  io_uring_sqe* sqes_ = nullptr;
+  std::size_t sqLen_ = 0;
+  std::size_t cqLen_ = 0;
+  std::size_t sqesLen_ = 0;
+  unsigned* sqTail_ = nullptr;
+  unsigned sqMask_ = 0;
+  unsigned* sqArray_ = nullptr;
+  unsigned* cqHead_ = nullptr;
+  unsigned* cqTail_ = nullptr;
+  unsigned cqMask_ = 0;
+  io_uring_cqe* cqes_ = nullptr;
+  std::array<iovec, kMaxBatch> iovs_;
+};
+#endif
+
+// The argument is the batch size. One iteration is one read + write pair so
+// the time per iteration is the amortized cost per operation.
+template <typename T>
+void benchIo(benchmark::State& state) {
+  auto batch = static_cast<unsigned>(state.range(0));
+  T io;
+  if (!io.ok()) {
+    state.SkipWithError("I/O setup failed (io_uring may be disabled).");
+    return;
+  }
+
+  while (state.KeepRunningBatch(batch)) {
+    if (!io.run(batch)) {
+      state.SkipWithError("I/O failed.");
+      return;
+    }
+  }
+  state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations()) *
+                          static_cast<std::int64_t>(2 * kIoSize));
+}
+
+void batchArgs(benchmark::internal::Benchmark* b) {
+  b->RangeMultiplier(4)->Range(1, kMaxBatch);
+}
+
+// clock_gettime(...) of CLOCK_MONOTONIC(_COARSE) is served by the vDSO: a
+// function mapped into every process which reads the time from a page shared
+// with the kernel, no syscall. It should be 10x+ faster than the same call via
+// syscall(...) (on par with benchSysCall) and CLOCK_PROCESS_CPUTIME_ID which
+// the vDSO doesn't implement. The coarse clock skips rdtsc and is only as
+// precise as the timer tick.
+//
+// A FUTEX_WAKE without waiters is a plain syscall. A wait/wake round trip
+// between two threads costs two context switches (or cross-core wakeups) and
+// is in the microseconds, which is why mutexes and thread pools spin briefly
+// before they sleep. sched_yield() is a syscall plus a trip through the
+// scheduler, cheap when nothing else is runnable. membarrier(...) is the
+// slow side of asymmetric fences (e.g. RCU readers without barriers): private
+// expedited costs an IPI round to the other cpus running this process, global
+// waits for a grace period and takes milliseconds.
+//
+// benchIo shows the amortized cost per read + write of 64 bytes as the batch
+// size grows. SingleIo doesn't batch: 2 syscalls per operation. VectoredIo
+// makes 2 syscalls per batch but only works for contiguous ranges of one file.
+// UringIo makes 1 io_uring_enter(...) per batch for any mix of operations, but
+// each operation goes through io_uring's request machinery so with a batch of
+// 1 it is slower than SingleIo. It pulls ahead once enough operations share
+// the syscall, as long as they complete inline: operations which would block
+// (e.g. buffered writes on filesystems without non-blocking write support) are
+// punted to io_uring worker threads, which shows as real time well above cpu
+// time and can cost more than the syscalls saved.
+BENCHMARK_TEMPLATE(benchClockGettime, VdsoMonotonic);
+BENCHMARK_TEMPLATE(benchClockGettime, VdsoMonotonicCoarse);
+BENCHMARK_TEMPLATE(benchClockGettime, SysCallMonotonic);
+BENCHMARK_TEMPLATE(benchClockGettime, ProcessCpuTime);
+BENCHMARK(benchFutexWake);
+BENCHMARK(benchFutexPingPong)->UseRealTime();
+BENCHMARK(benchSchedYield);
+#ifdef BITS_HAVE_MEMBARRIER
+BENCHMARK(benchMembarrier)
+    ->Arg(MEMBARRIER_CMD_PRIVATE_EXPEDITED)
+    ->Arg(MEMBARRIER_CMD_GLOBAL)
+    ->UseRealTime();
+#endif
+BENCHMARK_TEMPLATE(benchIo, SingleIo)->Apply(batchArgs);
+BENCHMARK_TEMPLATE(benchIo, VectoredIo)->Apply(batchArgs);
+#ifdef BITS_HAVE_IO_URING
+BENCHMARK_TEMPLATE(benchIo, UringIo)->Apply(batchArgs);
+#endif
+
 }  // namespace
 }  // namespace bits
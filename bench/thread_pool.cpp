@@ -0,0 +1,64 @@
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <future>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include <bits/thread_pool.hpp>
+
+namespace bits {
+namespace {
+
+// The sqrt workload from bin/hyperthreads over an L1 sized buffer so tasks are
+// bound by the throughput of the sqrt unit which SMT siblings share.
+constexpr std::size_t kBufLen = 4096;
+constexpr std::size_t kTasksPerThread = 8;
+
+void runWorkload() {
+  thread_local std::vector<double> buf(kBufLen, 2.0);
+  for (auto& d : buf) d = std::sqrt(d) + 1.0;
+  benchmark::DoNotOptimize(buf.data());
+}
+
+template <Placement P>
+void benchThreadPool(benchmark::State& state) {
+  auto numOfThreads = static_cast<std::size_t>(state.range(0));
+  ThreadPool pool{numOfThreads, P};
+  auto numOfTasks = numOfThreads * kTasksPerThread;
+
+  std::vector<std::future<void>> futures;
+  while (state.KeepRunning()) {
+    for (std::size_t k = 0; k < numOfTasks; k++)
+      futures.push_back(pool.submit(runWorkload));
+    for (auto& future : futures) future.wait();
+    futures.clear();
+  }
+
+  state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations()) *
+                          static_cast<std::int64_t>(numOfTasks * kBufLen));
+}
+
+void threadPoolArgs(benchmark::internal::Benchmark* b) {
+  b->RangeMultiplier(2)->Range(1, 16)->UseRealTime();
+}
+
+// Throughput (sqrt per second in items_per_second) of N pool workers running
+// the sqrt workload under each placement. Physical cores should scale
+// linearly until it runs out of cores and wraps around. Compact places pairs
+// of workers on SMT siblings so it should get noticeably less than 2x the
+// throughput of a single worker per core. Scatter only differs from physical
+// cores once there are several packages or more workers than cores. Unpinned
+// workers are up to the scheduler which usually (but not always) avoids
+// siblings.
+BENCHMARK_TEMPLATE(benchThreadPool, Placement::kNone)->Apply(threadPoolArgs);
+BENCHMARK_TEMPLATE(benchThreadPool, Placement::kPhysicalCores)
+    ->Apply(threadPoolArgs);
+BENCHMARK_TEMPLATE(benchThreadPool, Placement::kCompact)
+    ->Apply(threadPoolArgs);
+BENCHMARK_TEMPLATE(benchThreadPool, Placement::kScatter)
+    ->Apply(threadPoolArgs);
+
+}  // namespace
+}  // namespace bits
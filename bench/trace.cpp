@@ -0,0 +1,53 @@
+#include <cstdint>
+
+#include <benchmark/benchmark.h>
+
+#include <bits/trace.hpp>
+
+#include "environment.hpp"
+
+namespace bits {
+namespace {
+
+constexpr auto N = 1'000;
+
+// Records with made up timestamps, the cost of tracing minus the clock.
+void benchTraceRecord(benchmark::State& state) {
+  auto pin = pinBenchThread(state);
+  while (state.KeepRunningBatch(N)) {
+    for (auto k = 0; k < N; k++) {
+      auto t = static_cast<std::uint64_t>(k);
+      Tracer::record("bench.record", t, t, t);
+    }
+  }
+}
+
+void benchTraceInstant(benchmark::State& state) {
+  auto pin = pinBenchThread(state);
+  while (state.KeepRunningBatch(N)) {
+    for (auto k = 0; k < N; k++)
+      Tracer::instant("bench.instant", static_cast<std::uint64_t>(k));
+  }
+}
+
+void benchTraceScope(benchmark::State& state) {
+  auto pin = pinBenchThread(state);
+  while (state.KeepRunningBatch(N)) {
+    for (auto k = 0; k < N; k++) {
+      TraceScope scope{"bench.scope"};
+      benchmark::ClobberMemory();
+    }
+  }
+}
+
+// Cost per event. Recording is a thread local lookup and 5 stores to a ring
+// owned by the thread, so benchTraceRecord should take single digit ns and not
+// slow down with more threads. An instant adds a TSC read (without fences), a
+// scope reads the TSC twice. On bare metal rdtsc costs ~20 cycles, on VMs it
+// can be several times slower (or trap), see benchClockRead.
+BENCHMARK(benchTraceRecord)->ThreadRange(1, 4);
+BENCHMARK(benchTraceInstant)->ThreadRange(1, 4);
+BENCHMARK(benchTraceScope)->ThreadRange(1, 4);
+
+}  // namespace
+}  // namespace bits
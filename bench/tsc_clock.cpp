@@ -0,0 +1,73 @@
+#include <chrono>
+#include <cstdint>
+#include <type_traits>
+
+#include <benchmark/benchmark.h>
+
+#include <bits/tsc_clock.hpp>
+
+namespace bits {
+namespace {
+
+constexpr auto N = 1'000;
+
+struct SteadyClock {
+  static std::int64_t read() {
+    return std::chrono::steady_clock::now().time_since_epoch().count();
+  }
+};
+
+struct HighResolutionClock {
+  static std::int64_t read() {
+    return std::chrono::high_resolution_clock::now().time_since_epoch().count();
+  }
+};
+
+struct TscNow {
+  static std::int64_t read() {
+    return TscClock::now().time_since_epoch().count();
+  }
+};
+
+struct TscTicks {
+  static std::int64_t read() {
+    return static_cast<std::int64_t>(TscClock::readTicks());
+  }
+};
+
+struct TscTicksUnordered {
+  static std::int64_t read() {
+    return static_cast<std::int64_t>(TscClock::readTicksUnordered());
+  }
+};
+
+template <typename C>
+void benchClockRead(benchmark::State& state) {
+  if (std::is_same<C, TscNow>::value && !TscClock::getCalibration().reliable) {
+    state.SkipWithError("TSC is unreliable, TscClock uses steady_clock");
+    return;
+  }
+
+  while (state.KeepRunningBatch(N)) {
+    for (auto k = 0; k < N; k++) benchmark::DoNotOptimize(C::read());
+  }
+}
+
+// Cost of one clock read. steady_clock (and high_resolution_clock, an alias
+// for it with libstdc++) goes through clock_gettime(...) in the vDSO which
+// reads the TSC too, but also checks the clocksource and sequence counter of
+// the time page and converts the result: ~15-25 ns. TscClock::now() is a
+// fenced rdtsc plus a multiply and should take roughly half of that. The raw
+// reads skip the conversion, the unordered one also the fences and can overlap
+// with surrounding instructions so it is the cheapest (but least precise).
+//
+// Under virtualization without TSC passthrough rdtsc may trap to the
+// hypervisor and the vDSO falls back to a syscall, making all of these slow.
+BENCHMARK_TEMPLATE(benchClockRead, SteadyClock);
+BENCHMARK_TEMPLATE(benchClockRead, HighResolutionClock);
+BENCHMARK_TEMPLATE(benchClockRead, TscNow);
+BENCHMARK_TEMPLATE(benchClockRead, TscTicks);
+BENCHMARK_TEMPLATE(benchClockRead, TscTicksUnordered);
+
+}  // namespace
+}  // namespace bits
@@ -0,0 +1,232 @@
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <numeric>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include <bits/work_stealing.hpp>
+
+namespace bits {
+namespace {
+
+constexpr std::uint64_t kFibN = 30;
+constexpr std::uint64_t kFibCutoff = 16;
+constexpr std::size_t kSumLen = 1 << 24;
+constexpr std::size_t kSumCutoff = 1 << 14;
+constexpr std::size_t kSpawns = 10'000;
+
+// A pool of workers sharing a single mutex protected FIFO queue. Like the
+// WorkStealingPool, threads waiting for tasks run queued tasks instead of
+// blocking so recursive fork-join doesn't deadlock.
+class SharedQueuePool {
+ public:
+  explicit SharedQueuePool(std::size_t numOfThreads) {
+    for (std::size_t k = 0; k < numOfThreads; k++) {
+      threads_.emplace_back([this]() {
+        std::unique_lock<std::mutex> lock{mutex_};
+        while (true) {
+          cv_.wait(lock, [this]() { return stopped_ || !tasks_.empty(); });
+          if (tasks_.empty()) return;
+          auto task = std::move(tasks_.front());
+          tasks_.pop_front();
+          lock.unlock();
+          task();
+          lock.lock();
+        }
+      });
+    }
+  }
+
+  ~SharedQueuePool() {
+    {
+      std::lock_guard<std::mutex> lock{mutex_};
+      stopped_ = true;
+    }
+    cv_.notify_all();
+    for (auto& thread : threads_) thread.join();
+  }
+
+  void spawn(std::function<void()> task) {
+    {
+      std::lock_guard<std::mutex> lock{mutex_};
+      tasks_.push_back(std::move(task));
+    }
+    cv_.notify_one();
+  }
+
+  bool tryRunOne() {
+    std::unique_lock<std::mutex> lock{mutex_};
+    if (tasks_.empty()) return false;
+    auto task = std::move(tasks_.front());
+    tasks_.pop_front();
+    lock.unlock();
+    task();
+    return true;
+  }
+
+ private:
+  std::vector<std::thread> threads_;
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::deque<std::function<void()>> tasks_;
+  bool stopped_{false};
+};
+
+// Runs lhs() as a task and rhs() on the calling thread, then waits for both.
+struct WorkStealing {
+  explicit WorkStealing(std::size_t numOfThreads) : pool{numOfThreads} {}
+
+  template <typename L, typename R>
+  void join(L&& lhs, R&& rhs) {
+    TaskGroup group{pool};
+    group.spawn(std::forward<L>(lhs));
+    rhs();
+    group.wait();
+  }
+
+  WorkStealingPool pool;
+};
+
+struct SharedQueue {
+  explicit SharedQueue(std::size_t numOfThreads) : pool{numOfThreads} {}
+
+  template <typename L, typename R>
+  void join(L&& lhs, R&& rhs) {
+    std::atomic<bool> done{false};
+    pool.spawn([&lhs, &done]() {
+      lhs();
+      done.store(true, std::memory_order_release);
+    });
+    rhs();
+    while (!done.load(std::memory_order_acquire)) {
+      if (!pool.tryRunOne()) std::this_thread::yield();
+    }
+  }
+
+  SharedQueuePool pool;
+};
+
+// A new thread per fork, the number of threads is not bounded.
+struct Async {
+  explicit Async(std::size_t) {}
+
+  template <typename L, typename R>
+  void join(L&& lhs, R&& rhs) {
+    auto future = std::async(std::launch::async, std::forward<L>(lhs));
+    rhs();
+    future.get();
+  }
+};
+
+template <typename E>
+std::uint64_t fib(E& e, std::uint64_t n) {
+  if (n < kFibCutoff) return n < 2 ? n : fib(e, n - 1) + fib(e, n - 2);
+  std::uint64_t lhs;
+  std::uint64_t rhs;
+  e.join([&e, &lhs, n]() { lhs = fib(e, n - 1); },
+         [&e, &rhs, n]() { rhs = fib(e, n - 2); });
+  return lhs + rhs;
+}
+
+template <typename E>
+std::uint64_t sum(E& e, const std::uint64_t* begin, const std::uint64_t* end) {
+  auto n = static_cast<std::size_t>(end - begin);
+  if (n <= kSumCutoff) return std::accumulate(begin, end, std::uint64_t{0});
+  auto mid = begin + n / 2;
+  std::uint64_t lhs;
+  std::uint64_t rhs;
+  e.join([&e, &lhs, begin, mid]() { lhs = sum(e, begin, mid); },
+         [&e, &rhs, mid, end]() { rhs = sum(e, mid, end); });
+  return lhs + rhs;
+}
+
+template <typename E>
+void benchFib(benchmark::State& state) {
+  E e{static_cast<std::size_t>(state.range(0))};
+  while (state.KeepRunning()) benchmark::DoNotOptimize(fib(e, kFibN));
+}
+
+template <typename E>
+void benchSum(benchmark::State& state) {
+  E e{static_cast<std::size_t>(state.range(0))};
+  std::vector<std::uint64_t> buf(kSumLen);
+  std::iota(buf.begin(), buf.end(), 0);
+
+  while (state.KeepRunning())
+    benchmark::DoNotOptimize(sum(e, buf.data(), buf.data() + buf.size()));
+  state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations()) *
+                          static_cast<std::int64_t>(kSumLen * sizeof(buf[0])));
+}
+
+// Spawns kSpawns empty tasks from a task running on one of the workers (the
+// common case for fork-join) and waits for all of them.
+void benchSpawnWorkStealing(benchmark::State& state) {
+  WorkStealingPool pool{static_cast<std::size_t>(state.range(0))};
+  while (state.KeepRunningBatch(kSpawns)) {
+    TaskGroup outer{pool};
+    outer.spawn([&pool]() {
+      TaskGroup group{pool};
+      for (std::size_t k = 0; k < kSpawns; k++) group.spawn([]() {});
+      group.wait();
+    });
+    outer.wait();
+  }
+}
+
+void benchSpawnSharedQueue(benchmark::State& state) {
+  SharedQueuePool pool{static_cast<std::size_t>(state.range(0))};
+  while (state.KeepRunningBatch(kSpawns)) {
+    std::atomic<std::size_t> pending{kSpawns};
+    for (std::size_t k = 0; k < kSpawns; k++)
+      pool.spawn([&pending]() { pending.fetch_sub(1); });
+    while (pending.load() > 0) {
+      if (!pool.tryRunOne()) std::this_thread::yield();
+    }
+  }
+}
+
+void benchSpawnAsync(benchmark::State& state) {
+  std::vector<std::future<void>> futures;
+  while (state.KeepRunningBatch(kSpawns)) {
+    for (std::size_t k = 0; k < kSpawns; k++)
+      futures.push_back(std::async(std::launch::async, []() {}));
+    for (auto& future : futures) future.get();
+    futures.clear();
+  }
+}
+
+void workerArgs(benchmark::internal::Benchmark* b) {
+  b->RangeMultiplier(2)->Range(1, 16)->UseRealTime();
+}
+
+// Recursive fork-join (fib(30) with a serial cutoff and a parallel sum of 128
+// MB) over 1-16 workers. The work stealing pool should scale with the number
+// of cores: each worker mostly runs its own tasks and only touches shared
+// state when it runs out of work. Every task goes through the lock of the
+// shared queue which turns into the bottleneck as the number of workers grows
+// (and the FIFO order runs the oldest, biggest tasks first). std::async starts
+// a thread per fork, it has no pool so it only runs with a dummy argument.
+//
+// Spawn measures the cost per task (time per iteration / kSpawns) of spawning
+// and running empty tasks.
+BENCHMARK_TEMPLATE(benchFib, WorkStealing)->Apply(workerArgs);
+BENCHMARK_TEMPLATE(benchFib, SharedQueue)->Apply(workerArgs);
+BENCHMARK_TEMPLATE(benchFib, Async)->Arg(0)->UseRealTime();
+BENCHMARK_TEMPLATE(benchSum, WorkStealing)->Apply(workerArgs);
+BENCHMARK_TEMPLATE(benchSum, SharedQueue)->Apply(workerArgs);
+BENCHMARK_TEMPLATE(benchSum, Async)->Arg(0)->UseRealTime();
+BENCHMARK(benchSpawnWorkStealing)->Apply(workerArgs);
+BENCHMARK(benchSpawnSharedQueue)->Apply(workerArgs);
+BENCHMARK(benchSpawnAsync)->UseRealTime();
+
+}  // namespace
+}  // namespace bits
@@ -0,0 +1,275 @@
+// Compares two bits-bench JSON outputs and fails on significant regressions,
+// e.g. to check a change to rcu.hpp:
+//
+//   ARGS="--benchmark_filter=Rcu --benchmark_repetitions=10"
+//   ./bits-bench $ARGS --benchmark_out=baseline.json
+//   ... change rcu.hpp and rebuild ...
+//   ./bits-bench $ARGS --benchmark_out=contender.json
+//   ./benchcompare baseline.json contender.json
+//
+// Every benchmark needs several repetitions to estimate the noise. The
+// repetitions of a benchmark are compared with a (two-sided) Mann-Whitney U
+// test, which makes no assumptions about the distribution of timings, and a
+// change is significant if p < alpha and the medians differ by more than
+// threshold. Exits with 1 if any benchmark regressed and with 2 if the inputs
+// can't be compared, e.g. because the host fingerprints differ.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <exception>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <boost/optional.hpp>
+#include <boost/property_tree/json_parser.hpp>
+#include <boost/property_tree/ptree.hpp>
+
+namespace {
+
+// With less repetitions even the most extreme outcome of the U test isn't
+// significant at alpha = 0.05.
+constexpr std::size_t kMinRepetitions = 4;
+
+struct Options {
+  double alpha = 0.05;
+  double threshold = 0.05;
+  std::string metric = "cpu_time";
+  bool ignoreHost = false;
+  std::string baseline;
+  std::string contender;
+};
+
+struct Results {
+  std::map<std::string, std::string> host;
+  // Timings in ns of every repetition of every benchmark.
+  std::map<std::string, std::vector<double>> timings;
+  // Benchmark names in the order of the file.
+  std::vector<std::string> names;
+};
+
+bool endsWith(const std::string& s, const std::string& suffix) {
+  return s.size() >= suffix.size() &&
+         s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+double getNsPerUnit(const std::string& unit) {
+  if (unit == "us") return 1e3;
+  if (unit == "ms") return 1e6;
+  if (unit == "s") return 1e9;
+  return 1;
+}
+
+Results readResults(const std::string& path, const std::string& metric) {
+  boost::property_tree::ptree json;
+  boost::property_tree::read_json(path, json);
+
+  Results results;
+  if (auto host = json.get_child_optional("context.bits_host")) {
+    for (auto& field : *host)
+      results.host[field.first] = field.second.get_value<std::string>();
+  }
+
+  for (auto& entry : json.get_child("benchmarks")) {
+    auto& run = entry.second;
+    auto name = run.get<std::string>("name");
+    // Skip aggregates (google benchmark < 1.5 only marks them by name) and
+    // failed runs.
+    if (!run.get("aggregate_name", "").empty() ||
+        run.get("run_type", "iteration") != "iteration" ||
+        run.get("error_occurred", false) || endsWith(name, "_mean") ||
+        endsWith(name, "_median") || endsWith(name, "_stddev") ||
+        endsWith(name, "_BigO") || endsWith(name, "_RMS")) {
+      continue;
+    }
+    auto ns = run.get<double>(metric) *
+              getNsPerUnit(run.get<std::string>("time_unit", "ns"));
+    auto& timings = results.timings[name];
+    if (timings.empty()) results.names.push_back(name);
+    timings.push_back(ns);
+  }
+
+  return results;
+}
+
+double median(std::vector<double> xs) {
+  std::sort(xs.begin(), xs.end());
+  auto n = xs.size();
+  return n % 2 ? xs[n / 2] : (xs[n / 2 - 1] + xs[n / 2]) / 2;
+}
+
+// Returns the two-sided p-value of the Mann-Whitney U test via the normal
+// approximation with tie and continuity corrections.
+double mannWhitneyU(const std::vector<double>& xs,
+                    const std::vector<double>& ys) {
+  std::vector<std::pair<double, bool>> all;
+  for (auto x : xs) all.emplace_back(x, true);
+  for (auto y : ys) all.emplace_back(y, false);
+  std::sort(all.begin(), all.end());
+
+  // Sum of the ranks of xs, tied values get the average of their ranks.
+  double n = static_cast<double>(all.size());
+  double rankSum = 0;
+  double ties = 0;
+  for (std::size_t i = 0; i < all.size();) {
+    auto j = i;
+    while (j < all.size() && all[j].first == all[i].first) j++;
+    double t = static_cast<double>(j - i);
+    double rank = (static_cast<double>(i + j) + 1) / 2;
+    for (auto k = i; k < j; k++) {
+      if (all[k].second) rankSum += rank;
+    }
+    ties += t * t * t - t;
+    i = j;
+  }
+
+  double n1 = static_cast<double>(xs.size());
+  double n2 = static_cast<double>(ys.size());
+  double u = rankSum - n1 * (n1 + 1) / 2;
+  double mean = n1 * n2 / 2;
+  double variance = n1 * n2 / 12 * ((n + 1) - ties / (n * (n - 1)));
+  if (variance <= 0) return 1;
+  double z = std::max(std::abs(u - mean) - 0.5, 0.0) / std::sqrt(variance);
+  return std::erfc(z / std::sqrt(2));
+}
+
+bool parseDouble(const std::string& s, double& value) {
+  try {
+    value = std::stod(s);
+    return true;
+  } catch (const std::exception&) {
+    return false;
+  }
+}
+
+boost::optional<Options> parseOptions(int argc, char* argv[]) {
+  Options options;
+  std::vector<std::string> files;
+  for (auto k = 1; k < argc; k++) {
+    std::string arg = argv[k];
+    auto value = arg.substr(arg.find('=') + 1);
+    if (arg.compare(0, 8, "--alpha=") == 0) {
+      if (!parseDouble(value, options.alpha)) return boost::none;
+    } else if (arg.compare(0, 12, "--threshold=") == 0) {
+      if (!parseDouble(value, options.threshold)) return boost::none;
+    } else if (arg.compare(0, 9, "--metric=") == 0) {
+      options.metric = value;
+    } else if (arg == "--ignore-host") {
+      options.ignoreHost = true;
+    } else if (arg.compare(0, 2, "--") == 0) {
+      return boost::none;
+    } else {
+      files.push_back(arg);
+    }
+  }
+  if (files.size() != 2 ||
+      (options.metric != "cpu_time" && options.metric != "real_time")) {
+    return boost::none;
+  }
+  options.baseline = files[0];
+  options.contender = files[1];
+  return options;
+}
+
+// Returns false if the fingerprints differ.
+bool checkHosts(const Results& baseline, const Results& contender) {
+  if (baseline.host.empty() || contender.host.empty()) {
+    std::cerr << "Warning: no host fingerprint, results may not be comparable"
+              << std::endl;
+    return true;
+  }
+
+  auto same = true;
+  auto keys = baseline.host;
+  keys.insert(contender.host.begin(), contender.host.end());
+  for (auto& key : keys) {
+    auto lhs = baseline.host.find(key.first);
+    auto rhs = contender.host.find(key.first);
+    auto lhsValue = lhs == baseline.host.end() ? "?" : lhs->second;
+    auto rhsValue = rhs == contender.host.end() ? "?" : rhs->second;
+    if (lhsValue != rhsValue) {
+      std::cerr << "Host " << key.first << " differs: " << lhsValue << " vs. "
+                << rhsValue << std::endl;
+      same = false;
+    }
+  }
+  return same;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  auto options = parseOptions(argc, argv);
+  if (!options) {
+    std::cerr << "Usage: " << argv[0]
+              << " [--alpha=0.05] [--threshold=0.05]"
+                 " [--metric=cpu_time|real_time] [--ignore-host]"
+                 " <baseline.json> <contender.json>"
+              << std::endl;
+    return 2;
+  }
+
+  Results baseline, contender;
+  try {
+    baseline = readResults(options->baseline, options->metric);
+    contender = readResults(options->contender, options->metric);
+  } catch (const std::exception& e) {
+    std::cerr << e.what() << std::endl;
+    return 2;
+  }
+
+  if (!checkHosts(baseline, contender) && !options->ignoreHost) {
+    std::cerr << "Results from different hosts are not comparable, use "
+                 "--ignore-host to compare anyway"
+              << std::endl;
+    return 2;
+  }
+
+  std::size_t width = 9;
+  for (auto& name : baseline.names) width = std::max(width, name.size());
+
+  std::printf("%-*s %12s %12s %8s %8s\n", static_cast<int>(width), "Benchmark",
+              "Baseline ns", "New ns", "Change", "p");
+  std::size_t regressions = 0;
+  auto tooFewRepetitions = false;
+  for (auto& name : baseline.names) {
+    auto it = contender.timings.find(name);
+    if (it == contender.timings.end()) continue;
+    auto& xs = baseline.timings[name];
+    auto& ys = it->second;
+
+    auto lhs = median(xs);
+    auto rhs = median(ys);
+    auto change = lhs > 0 ? rhs / lhs - 1 : 0;
+    const char* verdict = "";
+    double p = 1;
+    if (xs.size() < kMinRepetitions || ys.size() < kMinRepetitions) {
+      tooFewRepetitions = true;
+      verdict = "(too few repetitions)";
+    } else {
+      p = mannWhitneyU(xs, ys);
+      if (p < options->alpha && change > options->threshold) {
+        verdict = "REGRESSION";
+        regressions++;
+      } else if (p < options->alpha && change < -options->threshold) {
+        verdict = "improvement";
+      }
+    }
+
+    std::printf("%-*s %12.3f %12.3f %+7.1f%% %8.4f%s%s\n",
+                static_cast<int>(width), name.c_str(), lhs, rhs, change * 100,
+                p, *verdict ? " " : "", verdict);
+  }
+
+  if (tooFewRepetitions) {
+    std::cerr << "Run with --benchmark_repetitions=" << 2 * kMinRepetitions
+              << " or more to test significance" << std::endl;
+  }
+  if (regressions > 0) {
+    std::cerr << regressions << " benchmark(s) regressed" << std::endl;
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,43 @@
+#include <iomanip>
+#include <iostream>
+
+#include <bits/affinity.hpp>
+#include <bits/core_latency.hpp>
+
+// This program measures the latency of transferring a cache line between each
+// pair of cpus by "ping-ponging" an atomic between two threads pinned to the
+// cpus. The latency depends on the shortest path between the cores: SMT
+// siblings share an L1 cache, cores on the same die (or CCX on AMD) share the
+// L3 cache and cores on different sockets have to go over the interconnect.
+// Threads which communicate a lot should be placed in the same latency domain.
+//
+// https://github.com/nviennot/core-to-core-latency
+int main(int argc, char* argv[]) {
+  auto cpus = bits::getAllowedCpus();
+  auto latencies = bits::measureCoreLatencies(cpus);
+
+  std::cout << "Round trip latency (ns):" << std::endl << std::endl;
+  std::cout << std::setw(6) << "";
+  for (auto cpu : cpus) std::cout << std::setw(6) << cpu;
+  std::cout << std::endl;
+  for (std::size_t i = 0; i < cpus.size(); i++) {
+    std::cout << std::setw(6) << cpus[i];
+    for (std::size_t j = 0; j < cpus.size(); j++) {
+      if (i == j) {
+        std::cout << std::setw(6) << "-";
+      } else {
+        std::cout << std::setw(6) << std::fixed << std::setprecision(0)
+                  << latencies.ns[i][j];
+      }
+    }
+    std::cout << std::endl;
+  }
+
+  std::cout << std::endl << "Latency domains:" << std::endl << std::endl;
+  for (const auto& domain : bits::getLatencyDomains(latencies)) {
+    for (auto cpu : domain) std::cout << cpu << " ";
+    std::cout << std::endl;
+  }
+
+  return 0;
+}
@@ -10,6 +10,9 @@ void gotPlt1();
 //    $ gcc -shared -fPIC -g -O3 -o build/libgot_plt_2.so src/got_plt_2.c
 //    $ gcc -g -O3 -o build/got_plt bin/got_plt.c build/libgot_plt_1.so build/libgot_plt_2.so
 //
+//    Or let meson build the got_plt target (and bench/got_plt.cpp which
+//    measures the call chain built in different ways).
+//
 // 2. Inspect the shared libraries referenced:
 //
 //    $ ldd build/got_plt
@@ -1,112 +1,44 @@
-#include <pthread.h>
-#include <sched.h>
-
-#include <chrono>
-#include <cmath>
 #include <cstddef>
-#include <cstdint>
 #include <iostream>
-#include <stdexcept>
-#include <thread>
 #include <vector>
 
-#include <boost/optional.hpp>
+#include <bits/cpu_topology.hpp>
 
 namespace {
 
-constexpr std::size_t kBufLen = 1'000'000;
-
-struct Sibling {
-  std::uint64_t core;
-  std::uint64_t timeUs;
-};
-
-template <typename F>
-std::uint64_t timeUs(F&& f) {
-  auto begin = std::chrono::steady_clock::now();
-  f();
-  auto end = std::chrono::steady_clock::now();
-  return std::chrono::duration_cast<std::chrono::microseconds>(end - begin)
-      .count();
-}
-
-std::vector<double> createWorkload() {
-  std::vector<double> buf(kBufLen);
-  double s = 1.0;
-  for (double& d : buf) {
-    d = s;
-    s *= 2;
-  }
-  return buf;
-}
-
-void runWorkload(double* buf) {
-  for (auto p = buf; p < buf + kBufLen; p++) *p = std::sqrt(*p);
-}
-
-std::thread runWorkloadOnCore(double* buf, std::uint64_t core) {
-  std::thread thread{[buf]() { runWorkload(buf); }};
-
-#if defined(__linux)
-  ::cpu_set_t cpuset;
-  CPU_ZERO(&cpuset);
-  CPU_SET(core, &cpuset);
-
-  auto code =
-      ::pthread_setaffinity_np(thread.native_handle(), sizeof(cpuset), &cpuset);
-  if (code != 0) throw std::runtime_error{"Error setting thread affinity."};
-#else
-  throw std::runtime_error{
-      "Thread affinities are not supported on your platform."};
-#endif
-
-  return thread;
-}
-
-boost::optional<Sibling> getSiblingCore(std::uint64_t core) {
-  auto buf = createWorkload();
-  auto base =
-      timeUs([&buf, core]() { runWorkloadOnCore(buf.data(), core).join(); });
-
-  auto cores = std::thread::hardware_concurrency();
-  for (std::uint64_t cand = 0; cand < cores; cand++) {
-    if (cand == core) continue;
-    auto bufLhs = createWorkload();
-    auto bufRhs = createWorkload();
-    auto t = timeUs([&bufLhs, &bufRhs, core, cand]() {
-      auto lhs = runWorkloadOnCore(bufLhs.data(), core);
-      auto rhs = runWorkloadOnCore(bufRhs.data(), cand);
-      lhs.join();
-      rhs.join();
-    });
-    auto r = static_cast<double>(t) / base;
-    if (r > 1.25) return Sibling{cand, t};
-  }
-  return boost::none;
+void printCpus(const std::vector<std::size_t>& cpus) {
+  for (std::size_t k = 0; k < cpus.size(); k++)
+    std::cout << (k > 0 ? " " : "") << cpus[k];
 }
 
 }  // namespace
 
 // This program can detect virtual cores which are "siblings" aka reside on the
-// same physical core and cooperate via hyperthreading. This is done by running
-// a CPU heavy workload on all pairs of cores and detecting the slowest pairs.
+// same physical core and cooperate via hyperthreading. The sibling candidates
+// are read from sysfs and verified by running a CPU heavy workload on all of
+// them at once and checking which cpus slow each other down.
 //
 // https://eli.thegreenplace.net/2016/c11-threads-affinity-and-hyperthreading/
 int main(int argc, char* argv[]) {
-  auto buf = createWorkload();
-  auto t = timeUs([&buf]() { runWorkload(buf.data()); });
-  std::cout << "Single-Threaded workload took: " << t << " us." << std::endl;
+  auto topology = bits::CpuTopology::probe();
+
+  for (const auto& core : topology.cores()) {
+    std::cout << "Core: ";
+    printCpus(core);
+    std::cout << (core.size() > 1 ? " are siblings." : " has no sibling.")
+              << std::endl;
+  }
+
+  for (const auto& package : topology.packages()) {
+    std::cout << "Package: ";
+    printCpus(package);
+    std::cout << std::endl;
+  }
 
-  auto cores = std::thread::hardware_concurrency();
-  for (std::uint64_t core = 0; core < cores; core++) {
-    auto sibling = getSiblingCore(core);
-    if (sibling) {
-      std::cout << core << ": " << sibling->core
-                << " is a sibling. Workload took " << sibling->timeUs << " us."
-                << std::endl;
-    } else {
-      std::cout << core << ": No sibling." << std::endl;
-    }
+  for (const auto& node : topology.nodes()) {
+    std::cout << "NUMA node: ";
+    printCpus(node);
+    std::cout << std::endl;
   }
 
   return 0;
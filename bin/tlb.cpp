@@ -0,0 +1,21 @@
+#include <iostream>
+
+#include <bits/tlb.hpp>
+
+int main(int argc, char* argv[]) {
+  auto reach = bits::getTlbReach();
+  if (!reach) {
+    std::cout << "TLB: unknown" << std::endl;
+    return 0;
+  }
+
+  std::cout << "L1 dTLB: " << reach->l1Entries << " entries, "
+            << reach->l1Reach() / 1024 << " KB reach" << std::endl;
+  if (reach->l2Entries) {
+    std::cout << "STLB: " << *reach->l2Entries << " entries, "
+              << *reach->l2Reach() / 1024 << " KB reach" << std::endl;
+  } else {
+    std::cout << "STLB: unknown" << std::endl;
+  }
+  return 0;
+}
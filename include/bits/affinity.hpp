@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+#include <bits/export.hpp>
+
+namespace bits {
+
+// Pins the thread to the cpu. Throws std::runtime_error on failure or if thread
+// affinities are not supported on your platform.
+BITS_EXPORT void pinThread(std::thread& thread, std::size_t cpu);
+
+// Pins the calling thread to the cpu. Throws std::runtime_error on failure or
+// if thread affinities are not supported on your platform.
+BITS_EXPORT void pinThisThread(std::size_t cpu);
+
+// Returns the cpus the calling thread is allowed to run on. This is all cpus
+// unless restricted by something like taskset or cgroups. Falls back to cpus
+// [0, std::thread::hardware_concurrency()) if thread affinities are not
+// supported on your platform.
+BITS_EXPORT std::vector<std::size_t> getAllowedCpus();
+
+}  // namespace bits
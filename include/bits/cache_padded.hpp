@@ -0,0 +1,149 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdlib>
+#include <functional>
+#include <limits>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace bits {
+
+// Number of bytes an object must own to not share a cache line with any other
+// object. This is 2x the 64 byte cache line on x86-64 because the spatial
+// prefetcher on Intel processors fetches cache lines in 128 byte aligned pairs,
+// so objects 64 bytes apart can still falsely share.
+//
+// TODO(amaximov): Figure out the cache line size programatically, perhaps by
+// probing for false sharing boundaries.
+constexpr std::size_t kCacheLinePad = 128;
+
+namespace detail {
+
+// True if Args is a single (possibly cv or reference qualified) Self.
+template <typename Self, typename... Args>
+struct IsSelf : std::false_type {};
+
+template <typename Self, typename Arg>
+struct IsSelf<Self, Arg>
+    : std::is_same<Self, typename std::decay<Arg>::type> {};
+
+}  // namespace detail
+
+// Wraps a T so it is aligned to and occupies (a multiple of) kCacheLinePad
+// bytes. This prevents false sharing between a T written by one thread and
+// neighboring objects accessed by other threads.
+//
+// Note that C++14 operator new(...) does not respect over-aligned types so
+// heap allocated CachePadded<T> objects should use a CacheAlignedAllocator.
+template <typename T>
+class alignas(kCacheLinePad) CachePadded {
+ public:
+  // Never matches a CachePadded, which would otherwise win over the copy
+  // constructor for non-const arguments.
+  template <typename... Args,
+            typename std::enable_if<
+                !detail::IsSelf<CachePadded, Args...>::value, int>::type = 0>
+  constexpr explicit CachePadded(Args&&... args)
+      : value_(std::forward<Args>(args)...) {}
+
+  T& get() { return value_; }
+  const T& get() const { return value_; }
+
+  T& operator*() { return value_; }
+  const T& operator*() const { return value_; }
+
+  T* operator->() { return &value_; }
+  const T* operator->() const { return &value_; }
+
+ private:
+  T value_;
+};
+
+// A std::allocator replacement which aligns allocations to kCacheLinePad bytes
+// (or alignof(T) if larger). This makes it safe to store CachePadded<T> in
+// standard containers such as std::vector.
+template <typename T>
+class CacheAlignedAllocator {
+ public:
+  using value_type = T;
+
+  CacheAlignedAllocator() = default;
+
+  template <typename U>
+  CacheAlignedAllocator(const CacheAlignedAllocator<U>&) {}
+
+  T* allocate(std::size_t n) {
+    if (n > std::numeric_limits<std::size_t>::max() / sizeof(T))
+      throw std::bad_alloc{};
+    void* p = nullptr;
+    if (::posix_memalign(&p, kAlignment, n * sizeof(T)) != 0)
+      throw std::bad_alloc{};
+    return static_cast<T*>(p);
+  }
+
+  void deallocate(T* p, std::size_t) { std::free(p); }
+
+ private:
+  static constexpr std::size_t kAlignment =
+      alignof(T) > kCacheLinePad ? alignof(T) : kCacheLinePad;
+};
+
+template <typename T, typename U>
+bool operator==(const CacheAlignedAllocator<T>&,
+                const CacheAlignedAllocator<U>&) {
+  return true;
+}
+
+template <typename T, typename U>
+bool operator!=(const CacheAlignedAllocator<T>&,
+                const CacheAlignedAllocator<U>&) {
+  return false;
+}
+
+// A fixed set of cache isolated T slots sharded by thread. Each thread maps to
+// one slot via local(...) so threads mostly write to their own cache line. The
+// mapping is based on a hash of the thread id so there are no guarantees that
+// a slot is exclusive to a single thread! Slots must be thread safe (atomics,
+// etc.) if more than one thread can access them.
+template <typename T>
+class CachePaddedSlots {
+ public:
+  CachePaddedSlots() : slots_(numOfShards()) {}
+
+  T& local() { return *slots_[shardOfThread()]; }
+  const T& local() const { return *slots_[shardOfThread()]; }
+
+  T& operator[](std::size_t shard) { return *slots_[shard]; }
+  const T& operator[](std::size_t shard) const { return *slots_[shard]; }
+
+  std::size_t size() const { return slots_.size(); }
+
+  static std::size_t numOfShards() {
+    static const auto kShards = []() {
+      // Use a power-of-two number of shards so we can use bitwise arithmetic
+      // instead of modulo when figuring out the thread shard.
+      std::size_t shards = 1;
+      while (shards < std::thread::hardware_concurrency() * 4) shards *= 2;
+      return shards;
+    }();
+
+    return kShards;
+  }
+
+  static std::size_t shardOfThread() {
+    static thread_local const auto kShard = []() {
+      std::hash<std::thread::id> h;
+      return h(std::this_thread::get_id()) & (numOfShards() - 1);
+    }();
+    return kShard;
+  }
+
+ private:
+  std::vector<CachePadded<T>, CacheAlignedAllocator<CachePadded<T>>> slots_;
+};
+
+}  // namespace bits
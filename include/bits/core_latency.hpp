@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include <bits/export.hpp>
+
+namespace bits {
+
+// Cache-line round trip latencies between pairs of cpus.
+struct CoreLatencies {
+  std::vector<std::size_t> cpus;
+
+  // The round trip latency in nanoseconds between cpus[i] and cpus[j] is
+  // ns[i][j]. The diagonal is zero.
+  std::vector<std::vector<double>> ns;
+};
+
+// Measures the round trip latency in nanoseconds of bouncing a cache line
+// between threads pinned to the lhs and rhs cpus. One thread writes to an
+// atomic which the other thread waits for and then writes back to, so each
+// round trip transfers ownership of the cache line twice. Both cpus MUST be
+// different and should be idle, otherwise the spinning threads compete for the
+// same core. Throws std::runtime_error if either thread can't be pinned.
+BITS_EXPORT double measureCoreLatency(std::size_t lhs, std::size_t rhs);
+
+// Measures the round trip latency between all pairs of the cpus, one pair at a
+// time.
+BITS_EXPORT CoreLatencies measureCoreLatencies(
+    const std::vector<std::size_t>& cpus);
+
+// Clusters cpus into latency domains. Two cpus are in the same domain if they
+// are connected by a path of pairs with a latency of at most threshold times
+// the smallest latency between any pair. Depending on the threshold, domains
+// are SMT siblings, CCXs (AMD), sockets, etc. Domains are sorted by their
+// smallest cpu.
+BITS_EXPORT std::vector<std::vector<std::size_t>> getLatencyDomains(
+    const CoreLatencies& latencies, double threshold = 1.5);
+
+}  // namespace bits
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include <bits/export.hpp>
+
+namespace bits {
+
+// Location of a logical cpu in the machine.
+struct CpuInfo {
+  std::size_t cpu;
+  // Index of the physical core, unique across packages. Logical cpus on the
+  // same physical core are SMT siblings (hyperthreads).
+  std::size_t core;
+  std::size_t package;
+  std::size_t node;
+};
+
+// The packages (sockets), physical cores, SMT siblings and NUMA nodes of the
+// logical cpus a process may run on. Groups of cpus are sorted by their id
+// (package, node) or smallest cpu (cores) and cpus within a group are sorted.
+class BITS_EXPORT CpuTopology {
+ public:
+  using Groups = std::vector<std::vector<std::size_t>>;
+
+  explicit CpuTopology(std::vector<CpuInfo> cpus);
+
+  // Reads the topology of the cpus the calling thread is allowed to run on
+  // from /sys/devices/system/{cpu,node}. If sysfs is not available every cpu
+  // is treated as a separate core of package 0 and node 0.
+  static CpuTopology read();
+
+  // Reads the topology via read() and then verifies the SMT siblings by timing
+  // a sqrt heavy workload. The workload runs on one cpu per core and then on
+  // all siblings of all cores at the same time. Siblings which do not slow
+  // each other down are split into separate cores. Each step runs in parallel
+  // over all cores so this takes a fraction of a second regardless of the
+  // number of cpus. Without sysfs, siblings are discovered by timing the
+  // workload on pairs of cpus one at a time, O(cores * cpus) serial probes
+  // which are much slower. The cpus SHOULD be idle. Throws std::runtime_error
+  // if the workload can't be pinned to the cpus.
+  static CpuTopology probe();
+
+  // Returns the topology from read() of when this was first called.
+  static const CpuTopology& get();
+
+  const std::vector<CpuInfo>& cpus() const { return cpus_; }
+
+  Groups packages() const;
+
+  Groups cores() const;
+
+  Groups nodes() const;
+
+  // Returns the SMT siblings of the cpu excluding the cpu itself. Empty if the
+  // cpu has no siblings or is not part of the topology.
+  std::vector<std::size_t> siblings(std::size_t cpu) const;
+
+ private:
+  std::vector<CpuInfo> cpus_;
+};
+
+// Parses a cpu list in the format of the kernel, e.g. "0-3,8,10-11". Throws
+// std::invalid_argument if the list is malformed.
+BITS_EXPORT std::vector<std::size_t> parseCpuList(const std::string& list);
+
+}  // namespace bits
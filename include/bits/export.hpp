@@ -0,0 +1,19 @@
+#pragma once
+
+// libbits is built with -fvisibility=hidden so only declarations marked
+// BITS_EXPORT are exported from the shared library. Everything else binds
+// locally: calls within the library are direct (no PLT) and can be inlined
+// since they can't be interposed, and the dynamic symbol table stays small.
+//
+// Classes with out-of-line members are exported as a whole. Header-only code
+// (templates, inline functions) needs no annotation as long as it has no state
+// of its own. A function-local static or static data member of a template or
+// inline function instantiated both in libbits and in a client gets a hidden
+// copy in each, e.g. the domain of RcuDomain<Tag>::get() or the depot of
+// ObjectPool<T>::getDepot(). Such state MUST only be used from one side, or
+// live in an exported out-of-line function (see ThreadLocalRegistry).
+#if defined(__GNUC__)
+#define BITS_EXPORT __attribute__((visibility("default")))
+#else
+#define BITS_EXPORT
+#endif
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <utility>
+
+#include <bits/cache_padded.hpp>
+
+namespace bits {
+
+// A bounded, lock-free multi-producer single-consumer queue. Any number of
+// threads may push but only one thread may pop at a time.
+//
+// Every slot has a sequence number which tells producers whether the slot is
+// free and the consumer whether it is ready, so producers and the consumer
+// never read each others' indexes. Producers claim slots with a CAS on the
+// shared tail which is on its own cache line, the head is private to the
+// consumer. A batch push claims all of its slots with a single CAS. Based on
+// Dmitry Vyukov's bounded MPMC queue:
+// https://www.1024cores.net/home/lock-free-algorithms/queues/bounded-mpmc-queue
+//
+// T MUST be default constructible and movable. The capacity is rounded up to a
+// power-of-2.
+template <typename T>
+class MpscQueue {
+ public:
+  explicit MpscQueue(std::size_t capacity)
+      : capacity_{roundUpToPow2(std::max<std::size_t>(capacity, 1))},
+        mask_{capacity_ - 1},
+        slots_{new Slot[capacity_]} {
+    for (std::size_t k = 0; k < capacity_; k++) slots_[k].seq.store(k);
+  }
+
+  MpscQueue(const MpscQueue&) = delete;
+  MpscQueue& operator=(const MpscQueue&) = delete;
+
+  // Returns false if the queue is full.
+  bool tryPush(T x) { return tryPushBatch(&x, &x + 1) == 1; }
+
+  // Returns false if the queue is empty.
+  bool tryPop(T& x) { return tryPopBatch(&x, 1) == 1; }
+
+  // Pushes as many items from [first, last) as fit and returns how many were
+  // pushed. Items are moved from. Pushed items are contiguous in the queue,
+  // they are not interleaved with items of other producers.
+  template <typename It>
+  std::size_t tryPushBatch(It first, It last) {
+    auto max = static_cast<std::size_t>(std::distance(first, last));
+    auto tail = tail_->load(std::memory_order_relaxed);
+    std::size_t n;
+    while (true) {
+      // The consumer frees slots in order so counting free slots from the tail
+      // finds all slots which can be claimed.
+      n = 0;
+      while (n < max && slots_[(tail + n) & mask_].seq.load(
+                            std::memory_order_acquire) == tail + n)
+        n++;
+      if (n == 0) {
+        // Either full or another producer claimed the slot first.
+        auto curr = tail_->load(std::memory_order_relaxed);
+        if (curr == tail) return 0;
+        tail = curr;
+        continue;
+      }
+      if (tail_->compare_exchange_weak(tail, tail + n,
+                                       std::memory_order_relaxed))
+        break;
+    }
+
+    for (std::size_t k = 0; k < n; k++, ++first) {
+      auto& slot = slots_[(tail + k) & mask_];
+      slot.value = std::move(*first);
+      slot.seq.store(tail + k + 1, std::memory_order_release);
+    }
+    return n;
+  }
+
+  // Pops up to max items into out and returns how many were popped. Only
+  // items pushed (and not just claimed) by producers are popped.
+  template <typename OutIt>
+  std::size_t tryPopBatch(OutIt out, std::size_t max) {
+    std::size_t n = 0;
+    for (; n < max; n++, ++out) {
+      auto& slot = slots_[head_ & mask_];
+      if (slot.seq.load(std::memory_order_acquire) != head_ + 1) break;
+      *out = std::move(slot.value);
+      slot.seq.store(head_ + capacity_, std::memory_order_release);
+      head_++;
+    }
+    return n;
+  }
+
+  std::size_t capacity() const { return capacity_; }
+
+ private:
+  static std::size_t roundUpToPow2(std::size_t n) {
+    std::size_t p = 1;
+    while (p < n) p *= 2;
+    return p;
+  }
+
+  struct Slot {
+    std::atomic<std::size_t> seq;
+    T value;
+  };
+
+  const std::size_t capacity_;
+  const std::size_t mask_;
+  const std::unique_ptr<Slot[]> slots_;
+  CachePadded<std::atomic<std::size_t>> tail_{0};
+  alignas(kCacheLinePad) std::size_t head_{0};
+};
+
+}  // namespace bits
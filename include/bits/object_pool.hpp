@@ -0,0 +1,266 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <bits/cache_padded.hpp>
+
+namespace bits {
+
+namespace detail {
+
+constexpr std::size_t kMagazineSize = 64;
+
+// A fixed size stack of free objects. Threads move free objects between each
+// other (via the depot) a magazine at a time.
+struct Magazine {
+  std::size_t count = 0;
+  std::array<void*, kMagazineSize> items;
+  std::atomic<Magazine*> next{nullptr};
+};
+
+// A lock-free (Treiber) stack of magazines. The head packs a 16 bit version
+// into the upper bits of the pointer (user space addresses on x86-64 and
+// AArch64 fit in 48 bits) so a pop(...) racing with a pop(...) and push(...)
+// of the same magazine fails its CAS instead of corrupting the stack (ABA).
+// Magazines are never freed so reading the next pointer of a magazine another
+// thread just popped is safe.
+class MagazineStack {
+ public:
+  void push(Magazine* magazine) {
+    auto head = head_->load(std::memory_order_relaxed);
+    do {
+      magazine->next.store(getPointer(head), std::memory_order_relaxed);
+    } while (!head_->compare_exchange_weak(head, pack(magazine, head),
+                                           std::memory_order_release,
+                                           std::memory_order_relaxed));
+  }
+
+  Magazine* pop() {
+    auto head = head_->load(std::memory_order_acquire);
+    while (auto magazine = getPointer(head)) {
+      auto next = magazine->next.load(std::memory_order_relaxed);
+      if (head_->compare_exchange_weak(head, pack(next, head),
+                                       std::memory_order_acquire,
+                                       std::memory_order_acquire))
+        return magazine;
+    }
+    return nullptr;
+  }
+
+ private:
+  static constexpr std::uint64_t kPointerMask = (std::uint64_t{1} << 48) - 1;
+
+  static Magazine* getPointer(std::uint64_t head) {
+    return reinterpret_cast<Magazine*>(head & kPointerMask);
+  }
+
+  // Packs the magazine with the version of the previous head + 1.
+  static std::uint64_t pack(Magazine* magazine, std::uint64_t prev) {
+    auto version = (prev & ~kPointerMask) + (kPointerMask + 1);
+    return version | reinterpret_cast<std::uint64_t>(magazine);
+  }
+
+  CachePadded<std::atomic<std::uint64_t>> head_{0};
+};
+
+}  // namespace detail
+
+// A thread caching pool of T sized (and aligned) blocks. This is the magazine
+// allocator from "Magazines and Vmem" (Bonwick and Adams, 2001):
+//
+// - Every thread caches up to 2 magazines of free objects so most allocations
+//   and deallocations are a push/pop on a thread local array without any
+//   atomics.
+// - When both magazines are full (empty) the thread exchanges one with a lock-
+//   free global depot of full (empty) magazines. This also moves objects freed
+//   by one thread back to threads that allocate them.
+// - Only when the depot is out of full magazines is a new slab of
+//   kMagazineSize objects allocated. Slabs are aligned to kCacheLinePad (or
+//   alignof(T) if larger).
+//
+// Memory is never returned to the system, the pool only grows to the peak
+// number of live objects (plus cached ones). The depot keeps track of all
+// slabs and magazines so they stay reachable, e.g. for leak checkers. Objects
+// may be freed on any thread. An optional Tag can be provided to use separate
+// pools for objects of the same type.
+//
+// The Deleter plugs into std::unique_ptr and RcuSnapshot<>::retire(...):
+//
+//   std::unique_ptr<Config, ObjectPool<Config>::Deleter> config{
+//       ObjectPool<Config>::create(...)};
+template <typename T, typename Tag = void>
+class ObjectPool {
+ public:
+  struct Deleter {
+    void operator()(T* p) const { destroy(p); }
+  };
+
+  template <typename... Args>
+  static T* create(Args&&... args) {
+    auto p = allocate();
+    try {
+      return new (p) T(std::forward<Args>(args)...);
+    } catch (...) {
+      deallocate(p);
+      throw;
+    }
+  }
+
+  static void destroy(T* p) {
+    if (!p) return;
+    p->~T();
+    deallocate(p);
+  }
+
+  // Returns uninitialized memory for a T.
+  static void* allocate() {
+    if (isCacheDestroyed()) return allocateFromDepot();
+    auto& cache = getCache();
+    if (cache.loaded->count == 0) {
+      if (cache.previous->count > 0) {
+        std::swap(cache.loaded, cache.previous);
+      } else if (auto full = getDepot().full.pop()) {
+        getDepot().empty.push(cache.previous);
+        cache.previous = cache.loaded;
+        cache.loaded = full;
+      } else {
+        fillFromSlab(cache.loaded);
+      }
+    }
+    return cache.loaded->items[--cache.loaded->count];
+  }
+
+  static void deallocate(void* p) {
+    if (isCacheDestroyed()) {
+      deallocateToDepot(p);
+      return;
+    }
+    auto& cache = getCache();
+    if (cache.loaded->count == detail::kMagazineSize) {
+      if (cache.previous->count == 0) {
+        std::swap(cache.loaded, cache.previous);
+      } else {
+        getDepot().full.push(cache.previous);
+        cache.previous = cache.loaded;
+        cache.loaded = getEmptyMagazine();
+      }
+    }
+    cache.loaded->items[cache.loaded->count++] = p;
+  }
+
+ private:
+  // sizeof(Slot) is sizeof(T) rounded up to alignof(T).
+  using Slot = typename std::aligned_storage<sizeof(T), alignof(T)>::type;
+
+  struct Depot {
+    detail::MagazineStack full;
+    detail::MagazineStack empty;
+
+    // The stacks only hold version tagged pointers.
+    std::mutex mutex;
+    std::vector<Slot*> slabs;
+    std::vector<detail::Magazine*> magazines;
+  };
+
+  // Returns the cached magazines to the depot on thread exit.
+  struct Cache {
+    Cache() : loaded{getEmptyMagazine()}, previous{getEmptyMagazine()} {}
+
+    ~Cache() {
+      isCacheDestroyed() = true;
+      for (auto magazine : {loaded, previous}) {
+        if (magazine->count > 0) {
+          getDepot().full.push(magazine);
+        } else {
+          getDepot().empty.push(magazine);
+        }
+      }
+    }
+
+    detail::Magazine* loaded;
+    detail::Magazine* previous;
+  };
+
+  static Depot& getDepot() {
+    // Never destroyed so objects can still be freed during static destruction.
+    // Depot has cache line padded members which plain new(...) doesn't align
+    // in C++14.
+    static auto depot = new (CacheAlignedAllocator<Depot>{}.allocate(1)) Depot;
+    return *depot;
+  }
+
+  static Cache& getCache() {
+    static thread_local Cache cache;
+    return cache;
+  }
+
+  // Set once the Cache of the calling thread has been destroyed. Other thread
+  // locals (e.g. the retired objects of RcuSnapshot<>) may still allocate and
+  // free objects in their destructors after that, depending on the order in
+  // which they were constructed. Trivially destructible so it outlives all of
+  // them.
+  static bool& isCacheDestroyed() {
+    static thread_local bool destroyed = false;
+    return destroyed;
+  }
+
+  // Slow paths which bypass the destroyed Cache, a magazine at a time.
+  static void* allocateFromDepot() {
+    auto& depot = getDepot();
+    auto magazine = depot.full.pop();
+    if (!magazine) {
+      magazine = getEmptyMagazine();
+      fillFromSlab(magazine);
+    }
+    auto p = magazine->items[--magazine->count];
+    if (magazine->count > 0) {
+      depot.full.push(magazine);
+    } else {
+      depot.empty.push(magazine);
+    }
+    return p;
+  }
+
+  static void deallocateToDepot(void* p) {
+    auto magazine = getEmptyMagazine();
+    magazine->items[magazine->count++] = p;
+    getDepot().full.push(magazine);
+  }
+
+  static detail::Magazine* getEmptyMagazine() {
+    auto& depot = getDepot();
+    if (auto magazine = depot.empty.pop()) return magazine;
+    std::unique_ptr<detail::Magazine> magazine{new detail::Magazine{}};
+    std::lock_guard<std::mutex> lock{depot.mutex};
+    depot.magazines.push_back(magazine.get());
+    return magazine.release();
+  }
+
+  static void fillFromSlab(detail::Magazine* magazine) {
+    CacheAlignedAllocator<Slot> allocator;
+    auto slab = allocator.allocate(detail::kMagazineSize);
+    try {
+      auto& depot = getDepot();
+      std::lock_guard<std::mutex> lock{depot.mutex};
+      depot.slabs.push_back(slab);
+    } catch (...) {
+      allocator.deallocate(slab, detail::kMagazineSize);
+      throw;
+    }
+    for (std::size_t k = 0; k < detail::kMagazineSize; k++)
+      magazine->items[k] = slab + k;
+    magazine->count = detail::kMagazineSize;
+  }
+};
+
+}  // namespace bits
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstddef>
+#include <limits>
+#include <new>
+
+#include <bits/export.hpp>
+
+namespace bits {
+
+// Kinds of pages backing a memory mapping. Huge pages cover more memory per
+// TLB entry so random accesses over large working sets incur less TLB misses.
+enum class PageBacking {
+  // Base pages (4 KB on x86-64). Transparent huge pages are disabled for the
+  // mapping so this holds even when THP is set to "always".
+  kRegular,
+  // Transparent huge pages via madvise(MADV_HUGEPAGE). The kernel may still
+  // back (parts of) the mapping with base pages if it can't find contiguous
+  // physical memory.
+  kTransparent,
+  // Explicit huge pages from the hugetlbfs pool via mmap(MAP_HUGETLB). The
+  // pool is empty unless configured via /proc/sys/vm/nr_hugepages.
+  kExplicit,
+};
+
+// Returns the size of a base page.
+BITS_EXPORT std::size_t getPageSize();
+
+// Returns the size of a (PMD sized) huge page, usually 2 MB on x86-64.
+BITS_EXPORT std::size_t getHugePageSize();
+
+// Returns true if the system is configured to provide pages of the given kind
+// to this process. mapPages(...) falls back to other kinds of pages if not.
+BITS_EXPORT bool isPageBackingAvailable(PageBacking backing);
+
+// Returns the number of bytes mapPages(size, backing) actually maps: size
+// rounded up to the base page size for regular pages and to the huge page size
+// otherwise. The rounding does not depend on what mapPages(...) falls back to.
+BITS_EXPORT std::size_t getMappedSize(std::size_t size, PageBacking backing);
+
+// Maps at least size bytes of zeroed, anonymous memory backed by the requested
+// kind of pages. Falls back from explicit to transparent to regular pages if
+// the requested kind is not available. The kind of pages actually used is
+// stored in *actual if provided. Throws std::bad_alloc on failure.
+BITS_EXPORT void* mapPages(std::size_t size, PageBacking backing,
+                           PageBacking* actual = nullptr);
+
+// Unmaps memory returned by mapPages(size, backing, ...). The size and backing
+// MUST be the same as passed to mapPages(...).
+BITS_EXPORT void unmapPages(void* p, std::size_t size, PageBacking backing);
+
+// A (stateful) allocator which places allocations on pages of the configured
+// kind. Every allocation is a separate mapping so this is only useful for
+// large allocations, e.g. reserved std::vector buffers.
+//
+// The kind of pages mapPages(...) actually used for the most recent allocation
+// is stored in *actual if provided, e.g. to detect that the hugetlbfs pool
+// ran out. Copies of the allocator share actual.
+template <typename T>
+class PageAllocator {
+ public:
+  using value_type = T;
+
+  explicit PageAllocator(PageBacking backing, PageBacking* actual = nullptr)
+      : backing_{backing}, actual_{actual} {}
+
+  template <typename U>
+  PageAllocator(const PageAllocator<U>& other)
+      : backing_{other.backing()}, actual_{other.actual()} {}
+
+  T* allocate(std::size_t n) {
+    if (n > std::numeric_limits<std::size_t>::max() / sizeof(T))
+      throw std::bad_alloc{};
+    return static_cast<T*>(mapPages(n * sizeof(T), backing_, actual_));
+  }
+
+  void deallocate(T* p, std::size_t n) {
+    unmapPages(p, n * sizeof(T), backing_);
+  }
+
+  PageBacking backing() const { return backing_; }
+  PageBacking* actual() const { return actual_; }
+
+ private:
+  PageBacking backing_;
+  PageBacking* actual_;
+};
+
+template <typename T, typename U>
+bool operator==(const PageAllocator<T>& lhs, const PageAllocator<U>& rhs) {
+  return lhs.backing() == rhs.backing();
+}
+
+template <typename T, typename U>
+bool operator!=(const PageAllocator<T>& lhs, const PageAllocator<U>& rhs) {
+  return !(lhs == rhs);
+}
+
+}  // namespace bits
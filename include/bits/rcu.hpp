@@ -6,66 +6,40 @@
 #include <cstddef>
 #include <cstdint>
 #include <functional>
-#include <thread>
+#include <memory>
+#include <utility>
 #include <vector>
 
+#include <bits/cache_padded.hpp>
+#include <bits/trace.hpp>
+
 namespace bits {
 
 namespace detail {
 
-// A sharded reference counter optimized for 64 byte cache lines on x86-64. This
-// offers *much* better (linear!) throughput scaling for increment/decrement
-// callers (RCU readers) as the number of threads increases at the cost of (1)
-// much higher memory usage and (2) slower load(...) than a single
-// std::atomic<...>. On a 4-core processor this will use
-// 2kb of memory, much more than 8 bytes for a single std::atomic<...>. Based on
-// "A Catalog of Read Indicators":
+// A sharded reference counter optimized for x86-64 cache lines. This offers
+// *much* better (linear!) throughput scaling for increment/decrement callers
+// (RCU readers) as the number of threads increases at the cost of (1) much
+// higher memory usage and (2) slower load(...) than a single std::atomic<...>.
+// On a 4-core processor this will use 2kb of memory, much more than 8 bytes for
+// a single std::atomic<...>. Based on "A Catalog of Read Indicators":
 // http://concurrencyfreaks.blogspot.com/2014/11/a-catalog-of-read-indicators.html
-//
-// TODO(amaximov): Figure out the cache line size programatically, perhaps by
-// probing for false sharing boundaries.
 class RcuRefCounter {
  public:
-  RcuRefCounter() : counters_(numOfShards() * kCacheLinePad) {}
-
-  void increment() { counters_[shardOfThread()].fetch_add(1); }
+  void increment() { counters_.local().fetch_add(1); }
 
-  void decrement() { counters_[shardOfThread()].fetch_sub(1); }
+  void decrement() { counters_.local().fetch_sub(1); }
 
   std::uint64_t load() const {
     std::uint64_t sum = 0;
-    for (std::size_t shard = 0; shard < numOfShards(); shard++) {
-      sum += counters_[shard * kCacheLinePad].load();
+    for (std::size_t shard = 0; shard < counters_.size(); shard++) {
+      sum += counters_[shard].load();
     }
     return sum;
   }
 
  private:
-  static constexpr auto kCacheLinePad =
-      128 / sizeof(std::atomic<std::uint64_t>);
-
-  static std::size_t numOfShards() {
-    static const auto kShards = []() {
-      // Use a power-of-two number of shards so we can use bitwise arithmetic
-      // instead of modulo when figuring out the thread shard.
-      std::size_t shards = 1;
-      while (shards < std::thread::hardware_concurrency() * 4) shards *= 2;
-      return shards;
-    }();
-
-    return kShards;
-  };
-
-  static std::size_t shardOfThread() {
-    static thread_local const auto kShard = []() {
-      std::hash<std::thread::id> h;
-      auto k = h(std::this_thread::get_id());
-      return k & (numOfShards() - 1) * kCacheLinePad;
-    }();
-    return kShard;
-  }
-
-  std::vector<std::atomic<std::uint64_t>> counters_;
+  CachePaddedSlots<std::atomic<std::uint64_t>> counters_;
 };
 
 template <typename Tag = void>
@@ -80,6 +54,8 @@ class RcuDomain {
   void unlock(std::uint64_t version) { readers_[version & 1].decrement(); }
 
   void sync() {
+    BITS_TRACE_SCOPE("rcu.sync");
+
     // Ok... why does this work? Let's go step-by-step. Notice that we are using
     // sequential consistency for all atomic operations! This means there is
     // some consistent global order of operations on all threads as determined
@@ -224,7 +200,47 @@ class RcuSnapshot {
   // to see writes made before sync.
   static void sync() { detail::RcuDomain<Tag>::get().sync(); }
 
+  // Defers deleter(p) until all happens-before snapshots have been destroyed.
+  // Retired objects are buffered per thread and freed kRetireBatch at a time
+  // after a single sync(...), which amortizes the grace period over the whole
+  // batch. The deleter can return the object to an ObjectPool<T> instead of
+  // the system allocator. Like sync(...), MUST NOT be called while the calling
+  // thread holds a snapshot.
+  template <typename T, typename D = std::default_delete<T>>
+  static void retire(T* p, D deleter = D{}) {
+    auto& retired = getRetired();
+    retired.deleters.emplace_back(
+        [p, deleter = std::move(deleter)]() mutable { deleter(p); });
+    if (retired.deleters.size() >= kRetireBatch) retired.flush();
+  }
+
+  // Synchronizes and frees all objects retired by the calling thread.
+  static void flush() { getRetired().flush(); }
+
  private:
+  static constexpr std::size_t kRetireBatch = 64;
+
+  // Frees pending objects on thread exit.
+  struct Retired {
+    ~Retired() { flush(); }
+
+    void flush() {
+      if (deleters.empty()) return;
+      sync();
+      // A deleter may retire(...) more objects.
+      auto pending = std::move(deleters);
+      deleters.clear();
+      for (auto& deleter : pending) deleter();
+    }
+
+    std::vector<std::function<void()>> deleters;
+  };
+
+  static Retired& getRetired() {
+    static thread_local Retired retired;
+    return retired;
+  }
+
   std::uint64_t version_ = 0;
 };
 
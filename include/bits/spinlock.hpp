@@ -0,0 +1,255 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <new>
+#include <thread>
+#include <vector>
+
+#include <bits/cache_padded.hpp>
+
+namespace bits {
+
+// Hints the CPU that this is a spin-wait loop. On x86 the pause instruction
+// avoids a memory order violation (and pipeline flush) when the awaited cache
+// line changes and lets an SMT sibling use the core.
+inline void cpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_ia32_pause();
+#elif defined(__aarch64__)
+  asm volatile("yield");
+#endif
+}
+
+// Exponential backoff for spin-wait loops. Every pause(...) waits twice as long
+// as the previous one up to a limit, after which it also yields the cpu in case
+// the thread we are waiting for was preempted.
+class Backoff {
+ public:
+  void pause() {
+    for (std::uint32_t k = 0; k < spins_; k++) cpuRelax();
+    if (spins_ < kMaxSpins) {
+      spins_ *= 2;
+    } else {
+      std::this_thread::yield();
+    }
+  }
+
+ private:
+  static constexpr std::uint32_t kMaxSpins = 1024;
+
+  std::uint32_t spins_ = 1;
+};
+
+// All locks below are BasicLockable so they work with std::lock_guard, TAS and
+// TTAS are also Lockable (try_lock()). Their state is cache line padded so a
+// lock doesn't falsely share with the data it protects, at the cost of 128+
+// bytes per lock.
+
+// Test-and-set: every waiter keeps trying to exchange the flag which is a
+// write (RFO) even when the lock is held, so the cache line bounces between
+// all waiters. Backoff spreads the attempts out.
+class TasLock {
+ public:
+  void lock() {
+    Backoff backoff;
+    while (locked_->exchange(true, std::memory_order_acquire)) backoff.pause();
+  }
+
+  bool try_lock() {
+    return !locked_->exchange(true, std::memory_order_acquire);
+  }
+
+  void unlock() { locked_->store(false, std::memory_order_release); }
+
+ private:
+  CachePadded<std::atomic<bool>> locked_{false};
+};
+
+// Test-and-test-and-set: waiters spin on a (shared, cached) load and only try
+// the exchange once the lock looks free. Waiting is cheap but a release still
+// triggers a stampede of all waiters for the cache line.
+class TtasLock {
+ public:
+  void lock() {
+    Backoff backoff;
+    while (true) {
+      if (!locked_->load(std::memory_order_relaxed) &&
+          !locked_->exchange(true, std::memory_order_acquire))
+        return;
+      backoff.pause();
+    }
+  }
+
+  bool try_lock() {
+    return !locked_->load(std::memory_order_relaxed) &&
+           !locked_->exchange(true, std::memory_order_acquire);
+  }
+
+  void unlock() { locked_->store(false, std::memory_order_release); }
+
+ private:
+  CachePadded<std::atomic<bool>> locked_{false};
+};
+
+// A fair (FIFO) lock: threads take a ticket and wait for it to be served. Only
+// one atomic RMW per acquisition but all waiters spin on the same line which
+// every release invalidates.
+class TicketLock {
+ public:
+  void lock() {
+    auto ticket = next_->fetch_add(1, std::memory_order_relaxed);
+    Backoff backoff;
+    while (serving_->load(std::memory_order_acquire) != ticket)
+      backoff.pause();
+  }
+
+  void unlock() {
+    auto serving = serving_->load(std::memory_order_relaxed);
+    serving_->store(serving + 1, std::memory_order_release);
+  }
+
+ private:
+  CachePadded<std::atomic<std::uint32_t>> next_{0};
+  CachePadded<std::atomic<std::uint32_t>> serving_{0};
+};
+
+namespace detail {
+
+// Thread local free list of queue lock nodes. Nodes are cache line padded so
+// each waiter spins on a line nobody else reads. Nodes may move between
+// threads (CLH) so the list only owns nodes which are currently free.
+template <typename Node>
+class NodePool {
+ public:
+  ~NodePool() {
+    for (auto node : nodes_) destroy(node);
+  }
+
+  static Node* acquire() {
+    auto& nodes = local().nodes_;
+    if (nodes.empty()) return create();
+    auto node = nodes.back();
+    nodes.pop_back();
+    return node;
+  }
+
+  static void release(Node* node) { local().nodes_.push_back(node); }
+
+  static Node* create() {
+    return new (CacheAlignedAllocator<Node>{}.allocate(1)) Node{};
+  }
+
+  static void destroy(Node* node) {
+    node->~Node();
+    CacheAlignedAllocator<Node>{}.deallocate(node, 1);
+  }
+
+ private:
+  static NodePool& local() {
+    static thread_local NodePool pool;
+    return pool;
+  }
+
+  std::vector<Node*> nodes_;
+};
+
+}  // namespace detail
+
+// Mellor-Crummey and Scott queue lock: waiters form a linked list and each one
+// spins on a flag in its own node which its predecessor clears on release. A
+// release touches one remote line regardless of the number of waiters. FIFO.
+class McsLock {
+ public:
+  void lock() {
+    auto node = Pool::acquire();
+    node->next.store(nullptr, std::memory_order_relaxed);
+    node->locked.store(true, std::memory_order_relaxed);
+
+    auto prev = tail_->exchange(node, std::memory_order_acq_rel);
+    if (prev) {
+      prev->next.store(node, std::memory_order_release);
+      Backoff backoff;
+      while (node->locked.load(std::memory_order_acquire)) backoff.pause();
+    }
+    owner_ = node;
+  }
+
+  void unlock() {
+    auto node = owner_;
+    auto next = node->next.load(std::memory_order_acquire);
+    if (!next) {
+      auto expected = node;
+      if (tail_->compare_exchange_strong(expected, nullptr,
+                                         std::memory_order_release,
+                                         std::memory_order_relaxed)) {
+        Pool::release(node);
+        return;
+      }
+      // A successor swapped the tail but hasn't linked itself yet.
+      Backoff backoff;
+      while (!(next = node->next.load(std::memory_order_acquire)))
+        backoff.pause();
+    }
+    next->locked.store(false, std::memory_order_release);
+    Pool::release(node);
+  }
+
+ private:
+  struct alignas(kCacheLinePad) Node {
+    std::atomic<Node*> next{nullptr};
+    std::atomic<bool> locked{false};
+  };
+
+  using Pool = detail::NodePool<Node>;
+
+  CachePadded<std::atomic<Node*>> tail_{nullptr};
+
+  // Only accessed by the thread holding the lock.
+  Node* owner_ = nullptr;
+};
+
+// Craig, Landin and Hagersten queue lock: like MCS waiters spin on a local
+// flag, but on their predecessor's node which makes release a single store.
+// The releasing thread recycles its predecessor's node. FIFO.
+class ClhLock {
+ public:
+  ClhLock() { tail_->store(Pool::create()); }
+
+  ClhLock(const ClhLock&) = delete;
+  ClhLock& operator=(const ClhLock&) = delete;
+
+  ~ClhLock() { Pool::destroy(tail_->load()); }
+
+  void lock() {
+    auto node = Pool::acquire();
+    node->locked.store(true, std::memory_order_relaxed);
+
+    auto prev = tail_->exchange(node, std::memory_order_acq_rel);
+    Backoff backoff;
+    while (prev->locked.load(std::memory_order_acquire)) backoff.pause();
+    owner_ = node;
+    ownerPrev_ = prev;
+  }
+
+  void unlock() {
+    auto prev = ownerPrev_;
+    owner_->locked.store(false, std::memory_order_release);
+    Pool::release(prev);
+  }
+
+ private:
+  struct alignas(kCacheLinePad) Node {
+    std::atomic<bool> locked{false};
+  };
+
+  using Pool = detail::NodePool<Node>;
+
+  CachePadded<std::atomic<Node*>> tail_{nullptr};
+
+  // Only accessed by the thread holding the lock.
+  Node* owner_ = nullptr;
+  Node* ownerPrev_ = nullptr;
+};
+
+}  // namespace bits
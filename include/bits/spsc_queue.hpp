@@ -0,0 +1,104 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <utility>
+
+#include <bits/cache_padded.hpp>
+
+namespace bits {
+
+// A bounded, lock-free single-producer single-consumer ring buffer. Exactly one
+// thread may push and one (other) thread may pop at a time.
+//
+// The producer owns the tail index and the consumer owns the head index, each
+// on its own cache line. Each side also keeps a cached copy of the other
+// side's index and only re-reads the (remote) index when the cached copy says
+// the queue is full (producer) or empty (consumer). In steady state this means
+// one cache line transfer per side every capacity items instead of one per
+// item. The batch operations additionally publish all items with a single
+// store.
+//
+// T MUST be default constructible and movable. The capacity is rounded up to a
+// power-of-2.
+template <typename T>
+class SpscQueue {
+ public:
+  explicit SpscQueue(std::size_t capacity)
+      : capacity_{roundUpToPow2(std::max<std::size_t>(capacity, 1))},
+        mask_{capacity_ - 1},
+        slots_{new T[capacity_]} {}
+
+  SpscQueue(const SpscQueue&) = delete;
+  SpscQueue& operator=(const SpscQueue&) = delete;
+
+  // Returns false if the queue is full.
+  bool tryPush(T x) { return tryPushBatch(&x, &x + 1) == 1; }
+
+  // Returns false if the queue is empty.
+  bool tryPop(T& x) { return tryPopBatch(&x, 1) == 1; }
+
+  // Pushes as many items from [first, last) as fit and returns how many were
+  // pushed. Items are moved from.
+  template <typename It>
+  std::size_t tryPushBatch(It first, It last) {
+    auto n = static_cast<std::size_t>(std::distance(first, last));
+    auto tail = producer_->tail.load(std::memory_order_relaxed);
+    if (capacity_ - (tail - producer_->headCache) < n) {
+      producer_->headCache = consumer_->head.load(std::memory_order_acquire);
+      n = std::min(n, capacity_ - (tail - producer_->headCache));
+    }
+
+    for (std::size_t k = 0; k < n; k++, ++first)
+      slots_[(tail + k) & mask_] = std::move(*first);
+    producer_->tail.store(tail + n, std::memory_order_release);
+    return n;
+  }
+
+  // Pops up to max items into out and returns how many were popped.
+  template <typename OutIt>
+  std::size_t tryPopBatch(OutIt out, std::size_t max) {
+    auto head = consumer_->head.load(std::memory_order_relaxed);
+    auto n = consumer_->tailCache - head;
+    if (n < max) {
+      consumer_->tailCache = producer_->tail.load(std::memory_order_acquire);
+      n = consumer_->tailCache - head;
+    }
+    n = std::min(n, max);
+
+    for (std::size_t k = 0; k < n; k++, ++out)
+      *out = std::move(slots_[(head + k) & mask_]);
+    consumer_->head.store(head + n, std::memory_order_release);
+    return n;
+  }
+
+  std::size_t capacity() const { return capacity_; }
+
+ private:
+  static std::size_t roundUpToPow2(std::size_t n) {
+    std::size_t p = 1;
+    while (p < n) p *= 2;
+    return p;
+  }
+
+  struct Producer {
+    std::atomic<std::size_t> tail{0};
+    std::size_t headCache{0};
+  };
+
+  struct Consumer {
+    std::atomic<std::size_t> head{0};
+    std::size_t tailCache{0};
+  };
+
+  const std::size_t capacity_;
+  const std::size_t mask_;
+  const std::unique_ptr<T[]> slots_;
+  CachePadded<Producer> producer_;
+  CachePadded<Consumer> consumer_;
+};
+
+}  // namespace bits
@@ -1,12 +1,22 @@
 #pragma once
 
+#include <bits/export.hpp>
+
 namespace bits {
 
-class Statics {
+class BITS_EXPORT Statics {
  public:
   static void* get();
 
   static void* getTL();
+
+  // Same as getTL() but each defined in a separate library built with a
+  // different TLS model (or dialect), see tls_variant_defs in meson.build.
+  static void* getTLGlobalDynamic();
+  static void* getTLInitialExec();
+  static void* getTLDescriptors();
+  static void* getTLStatic();
+  static void* getTLLocalExec();
 };
 
 }  // namespace bits
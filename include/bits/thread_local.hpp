@@ -0,0 +1,146 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include <boost/iterator/indirect_iterator.hpp>
+
+#include <bits/export.hpp>
+
+namespace bits {
+
+namespace detail {
+
+// The value of one ThreadLocal<T> on one thread.
+struct ThreadLocalElement {
+  void* p = nullptr;
+  void (*dispose)(void*) = nullptr;
+};
+
+// All ThreadLocal<T> values of a thread, indexed by ThreadLocal<T> id.
+struct ThreadLocalEntry {
+  ThreadLocalElement* elements = nullptr;
+  std::size_t capacity = 0;
+};
+
+// Trivially constructible (constant initialized) so no dynamic initialization
+// guard is needed when accessing it.
+extern BITS_EXPORT thread_local ThreadLocalEntry* tlsThreadLocalEntry;
+
+class BITS_EXPORT ThreadLocalRegistry {
+ public:
+  static std::size_t acquireId();
+
+  // Disposes the values of the id on all threads and recycles the id.
+  static void releaseId(std::size_t id);
+
+  // Sets the value of the id on the calling thread. Values are disposed when
+  // the thread exits.
+  static void set(std::size_t id, void* p, void (*dispose)(void*));
+
+  // Returns the values of the id on all threads. The caller MUST hold
+  // getMutex() which prevents threads from exiting (disposing values) and new
+  // values from being set.
+  static std::vector<void*> getAll(std::size_t id);
+
+  // Recursive so the thread holding it (e.g. via an Accessor) can still
+  // create values of its own.
+  static std::recursive_mutex& getMutex();
+};
+
+}  // namespace detail
+
+// A thread local T per ThreadLocal<T> object, unlike thread_local which can
+// only be used for static (per program) storage. Useful for per-object sharded
+// state such as per-connection counters. Similar to folly::ThreadLocal:
+// https://github.com/facebook/folly/blob/master/folly/ThreadLocal.h
+//
+// Every ThreadLocal<T> gets a small integer id and every thread an array of
+// values indexed by id, so get() is a TLS access plus an indexed load. The
+// value is created on first access from a thread and destroyed when the thread
+// exits or the ThreadLocal<T> is destroyed, whichever comes first.
+//
+// The values of all threads can be iterated with accessAllThreads(), e.g. to
+// aggregate per thread counters. Accesses from other threads are not
+// synchronized with the owning thread so T MUST be safe to share, e.g. hold
+// std::atomic<...> counters written with relaxed stores.
+//
+// Note that a ThreadLocal<T> MUST NOT be destroyed while other threads use it
+// and MUST NOT be accessed from destructors of thread_local objects.
+template <typename T>
+class ThreadLocal {
+ public:
+  // Holds a lock which keeps threads from exiting (and new threads from adding
+  // values) while iterating. The lock is shared by all ThreadLocal<...>
+  // objects: other threads block on exit and on their first access of any
+  // ThreadLocal<...> until the Accessor is destroyed, so keep it short lived.
+  // The iterating thread itself may access (and create) values of any
+  // ThreadLocal<...>.
+  class Accessor {
+   public:
+    using Iterator =
+        boost::indirect_iterator<typename std::vector<T*>::const_iterator>;
+
+    Iterator begin() const { return Iterator{values_.begin()}; }
+    Iterator end() const { return Iterator{values_.end()}; }
+
+   private:
+    friend class ThreadLocal;
+
+    explicit Accessor(std::size_t id)
+        : lock_{detail::ThreadLocalRegistry::getMutex()} {
+      for (auto p : detail::ThreadLocalRegistry::getAll(id))
+        values_.push_back(static_cast<T*>(p));
+    }
+
+    std::unique_lock<std::recursive_mutex> lock_;
+    std::vector<T*> values_;
+  };
+
+  ThreadLocal() : ThreadLocal([]() { return new T{}; }) {}
+
+  // Values are created via factory().
+  explicit ThreadLocal(std::function<T*()> factory)
+      : id_{detail::ThreadLocalRegistry::acquireId()},
+        factory_{std::move(factory)} {}
+
+  ThreadLocal(const ThreadLocal&) = delete;
+  ThreadLocal& operator=(const ThreadLocal&) = delete;
+
+  ~ThreadLocal() { detail::ThreadLocalRegistry::releaseId(id_); }
+
+  T* get() const {
+    auto entry = detail::tlsThreadLocalEntry;
+    if (entry && id_ < entry->capacity) {
+      if (auto p = entry->elements[id_].p) return static_cast<T*>(p);
+    }
+    return create();
+  }
+
+  T* operator->() const { return get(); }
+  T& operator*() const { return *get(); }
+
+  Accessor accessAllThreads() const { return Accessor{id_}; }
+
+ private:
+  static void dispose(void* p) { delete static_cast<T*>(p); }
+
+  T* create() const {
+    auto p = factory_();
+    try {
+      detail::ThreadLocalRegistry::set(id_, p, &dispose);
+    } catch (...) {
+      delete p;
+      throw;
+    }
+    return p;
+  }
+
+  const std::size_t id_;
+  const std::function<T*()> factory_;
+};
+
+}  // namespace bits
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <bits/cpu_topology.hpp>
+#include <bits/export.hpp>
+
+namespace bits {
+
+// How worker threads are pinned to cpus. When there are more threads than cpus
+// selected by the placement, threads wrap around to the first cpu again.
+enum class Placement {
+  // Threads are not pinned and the scheduler places them.
+  kNone,
+  // One thread per physical core, SMT siblings are skipped. Cores are filled
+  // package by package.
+  kPhysicalCores,
+  // Threads are packed as closely as possible: all siblings of a core, then
+  // all cores of a package and only then the next package. Threads share
+  // caches (and execution units) at the cost of memory bandwidth.
+  kCompact,
+  // Threads are spread round robin across packages and within each package
+  // use all physical cores before SMT siblings. Threads get the most caches
+  // and memory bandwidth at the cost of cross-package communication.
+  kScatter,
+};
+
+// Returns the cpus numOfThreads threads are pinned to with the placement, or
+// an empty vector for Placement::kNone.
+BITS_EXPORT std::vector<std::size_t> placeThreads(
+    const CpuTopology& topology, Placement placement, std::size_t numOfThreads);
+
+// A fixed size pool of worker threads running tasks from a shared FIFO queue.
+// Workers are pinned to cpus on construction according to a placement or an
+// explicit list of cpus.
+class BITS_EXPORT ThreadPool {
+ public:
+  // Starts numOfThreads workers placed on the cpus of the topology. Throws
+  // std::runtime_error if the workers can't be pinned.
+  explicit ThreadPool(std::size_t numOfThreads,
+                      Placement placement = Placement::kNone,
+                      const CpuTopology& topology = CpuTopology::get());
+
+  // Starts one worker pinned to each of the cpus. Throws std::runtime_error if
+  // the workers can't be pinned.
+  explicit ThreadPool(const std::vector<std::size_t>& cpus);
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  // Runs the remaining tasks and joins the workers.
+  ~ThreadPool();
+
+  // Queues f() to run on one of the workers. The future holds the result or
+  // exception of f().
+  template <typename F>
+  std::future<typename std::result_of<F()>::type> submit(F&& f) {
+    using R = typename std::result_of<F()>::type;
+    auto task = std::make_shared<std::packaged_task<R()>>(std::forward<F>(f));
+    auto future = task->get_future();
+    post([task]() { (*task)(); });
+    return future;
+  }
+
+  // Returns the number of workers.
+  std::size_t size() const { return threads_.size(); }
+
+  // Returns the cpus workers are pinned to. Empty if workers are not pinned.
+  const std::vector<std::size_t>& cpus() const { return cpus_; }
+
+ private:
+  void start(std::size_t numOfThreads);
+
+  void stop();
+
+  void post(std::function<void()> task);
+
+  void run();
+
+  std::vector<std::size_t> cpus_;
+  std::vector<std::thread> threads_;
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::deque<std::function<void()>> tasks_;
+  bool stopped_{false};
+};
+
+}  // namespace bits
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+
+#include <boost/optional.hpp>
+
+#include <bits/export.hpp>
+
+namespace bits {
+
+// Estimated number of data TLB entries for base pages. The reach of a TLB is
+// the amount of memory it can map without a miss: entries * page size. Random
+// accesses over working sets larger than the reach pay for (1) a STLB lookup
+// once the L1 dTLB is exhausted and (2) a page walk once the STLB is exhausted.
+// Those working sets are good candidates for huge pages which multiply the
+// reach by 512x on x86-64 (2 MB vs. 4 KB pages).
+struct TlbReach {
+  std::size_t pageSize;
+  std::size_t l1Entries;
+  boost::optional<std::size_t> l2Entries;
+
+  std::size_t l1Reach() const { return l1Entries * pageSize; }
+
+  boost::optional<std::size_t> l2Reach() const {
+    if (!l2Entries) return boost::none;
+    return *l2Entries * pageSize;
+  }
+};
+
+// Calculates an estimate for the reach of the L1 dTLB and STLB. This is done
+// by timing random loads from one cache line per page over an increasing
+// number of pages and comparing with loads from the same number of cache lines
+// packed into as few pages as possible. The number of entries is rounded down
+// to a power-of-2.
+//
+// Returns an estimate for the TLB reach.
+BITS_EXPORT boost::optional<TlbReach> getTlbReach();
+
+}  // namespace bits
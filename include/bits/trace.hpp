@@ -0,0 +1,144 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <vector>
+
+#include <bits/cache_padded.hpp>
+#include <bits/export.hpp>
+#include <bits/thread_local.hpp>
+#include <bits/tsc_clock.hpp>
+
+namespace bits {
+
+// Size of the ring buffer of each thread. The most recent kTraceBufferSize - 1
+// events are kept, older events are overwritten.
+constexpr std::size_t kTraceBufferSize = 4096;
+
+namespace detail {
+
+// Fields are relaxed atomics so Tracer::dump(...) can read buffers while
+// their threads write to them, see TraceBuffer::snapshot(...).
+struct alignas(32) TraceRecord {
+  std::atomic<const char*> name{nullptr};
+  std::atomic<std::uint64_t> begin{0};
+  std::atomic<std::uint64_t> end{0};
+  std::atomic<std::uint64_t> arg{0};
+};
+
+struct TraceEvent {
+  const char* name;
+  std::uint64_t begin;
+  std::uint64_t end;
+  std::uint64_t arg;
+  int tid;
+};
+
+BITS_EXPORT int getTraceThreadId();
+
+// A single producer ring of the most recent events of a thread.
+class TraceBuffer {
+ public:
+  void record(const char* name, std::uint64_t begin, std::uint64_t end,
+              std::uint64_t arg) {
+    auto n = head_.load(std::memory_order_relaxed);
+    auto& record = records_[n & (kTraceBufferSize - 1)];
+    // Pairs with the acquire fence in snapshot(...): a reader which sees any
+    // of the stores below also sees head_ >= n and drops the slot. Free on
+    // x86-64.
+    std::atomic_thread_fence(std::memory_order_release);
+    record.name.store(name, std::memory_order_relaxed);
+    record.begin.store(begin, std::memory_order_relaxed);
+    record.end.store(end, std::memory_order_relaxed);
+    record.arg.store(arg, std::memory_order_relaxed);
+    head_.store(n + 1, std::memory_order_release);
+  }
+
+  // Appends the events of this buffer to events. Like a seqlock reader:
+  // events overwritten while they were copied are dropped.
+  void snapshot(std::vector<TraceEvent>& events) const;
+
+ private:
+  static_assert((kTraceBufferSize & (kTraceBufferSize - 1)) == 0,
+                "kTraceBufferSize MUST be a power of 2");
+
+  std::vector<TraceRecord, CacheAlignedAllocator<TraceRecord>> records_{
+      kTraceBufferSize};
+  std::atomic<std::uint64_t> head_{0};
+  const int tid_ = getTraceThreadId();
+};
+
+}  // namespace detail
+
+// A low overhead tracer for hot paths such as RCU grace periods, lock
+// acquisitions and queue hand-offs. Each thread appends fixed size records
+// to its own ring buffer, so recording an event is a thread local lookup, a
+// TSC read and a few plain stores: no locks, no shared cache lines, no
+// formatting. Only the most recent kTraceBufferSize - 1 events of each thread
+// are kept.
+//
+// dump(...) merges the buffers of all (live) threads into Chrome trace JSON
+// which can be viewed in chrome://tracing or https://ui.perfetto.dev. Events
+// of threads which have exited are lost.
+//
+// Event names MUST have static storage duration (e.g. string literals) since
+// only the pointer is recorded.
+//
+// Call sites should use the BITS_TRACE_... macros which compile to nothing
+// unless BITS_TRACING is defined (meson configure -Dtracing=true).
+class BITS_EXPORT Tracer {
+ public:
+  // Returns the current time in TscClock ticks.
+  static std::uint64_t now() { return TscClock::readTicksUnordered(); }
+
+  // Records an event which ran from begin to end (see now()). Events with
+  // begin == end are shown as instants.
+  static void record(const char* name, std::uint64_t begin, std::uint64_t end,
+                     std::uint64_t arg = 0) {
+    getBuffers()->record(name, begin, end, arg);
+  }
+
+  static void instant(const char* name, std::uint64_t arg = 0) {
+    auto t = now();
+    record(name, t, t, arg);
+  }
+
+  // Writes the events of all threads as Chrome trace JSON, ordered by time.
+  static void dump(std::ostream& out);
+
+ private:
+  static ThreadLocal<detail::TraceBuffer>& getBuffers();
+};
+
+// Records an event spanning the lifetime of the scope.
+class TraceScope {
+ public:
+  explicit TraceScope(const char* name, std::uint64_t arg = 0)
+      : name_{name}, arg_{arg}, begin_{Tracer::now()} {}
+
+  TraceScope(const TraceScope&) = delete;
+  TraceScope& operator=(const TraceScope&) = delete;
+
+  ~TraceScope() { Tracer::record(name_, begin_, Tracer::now(), arg_); }
+
+ private:
+  const char* name_;
+  std::uint64_t arg_;
+  std::uint64_t begin_;
+};
+
+}  // namespace bits
+
+#define BITS_TRACE_CONCAT_IMPL(a, b) a##b
+#define BITS_TRACE_CONCAT(a, b) BITS_TRACE_CONCAT_IMPL(a, b)
+
+#if defined(BITS_TRACING)
+#define BITS_TRACE_SCOPE(...) \
+  ::bits::TraceScope BITS_TRACE_CONCAT(bitsTraceScope, __LINE__) { __VA_ARGS__ }
+#define BITS_TRACE_INSTANT(...) ::bits::Tracer::instant(__VA_ARGS__)
+#else
+#define BITS_TRACE_SCOPE(...) static_cast<void>(0)
+#define BITS_TRACE_INSTANT(...) static_cast<void>(0)
+#endif
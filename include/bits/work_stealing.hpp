@@ -0,0 +1,262 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <bits/cache_padded.hpp>
+#include <bits/cpu_topology.hpp>
+#include <bits/export.hpp>
+#include <bits/thread_pool.hpp>
+
+namespace bits {
+
+namespace detail {
+
+// A lock-free work stealing deque of trivially copyable values (usually
+// pointers). The owner thread pushes and pops at the bottom (LIFO) while other
+// threads steal from the top (FIFO). The owner only synchronizes with thieves
+// when the deque is almost empty. Based on "Correct and Efficient
+// Work-Stealing for Weak Memory Models" (Lê et al., 2013) which fixes the
+// memory orders of the original Chase-Lev deque for C11 atomics:
+// https://fzn.fr/readings/ppopp13.pdf
+template <typename T>
+class ChaseLevDeque {
+ public:
+  // The capacity MUST be a power-of-2. The deque grows as needed.
+  explicit ChaseLevDeque(std::size_t capacity = 256) {
+    arrays_.emplace_back(new Array{capacity});
+    array_.store(arrays_.back().get());
+  }
+
+  ChaseLevDeque(const ChaseLevDeque&) = delete;
+  ChaseLevDeque& operator=(const ChaseLevDeque&) = delete;
+
+  // Pushes x to the bottom. Only the owner may call this.
+  void push(T x) {
+    auto b = bottom_->load(std::memory_order_relaxed);
+    auto t = top_->load(std::memory_order_acquire);
+    auto a = array_.load(std::memory_order_relaxed);
+    if (b - t > static_cast<std::int64_t>(a->mask)) a = grow(a, t, b);
+    a->put(b, x);
+    std::atomic_thread_fence(std::memory_order_release);
+    bottom_->store(b + 1, std::memory_order_relaxed);
+  }
+
+  // Pops the bottom value into x. Returns false if the deque is empty or a
+  // thief took the last value. Only the owner may call this.
+  bool pop(T& x) {
+    auto b = bottom_->load(std::memory_order_relaxed) - 1;
+    auto a = array_.load(std::memory_order_relaxed);
+    bottom_->store(b, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    auto t = top_->load(std::memory_order_relaxed);
+
+    if (t > b) {
+      bottom_->store(b + 1, std::memory_order_relaxed);
+      return false;
+    }
+
+    x = a->get(b);
+    if (t < b) return true;
+
+    // Last value, race thieves for it.
+    auto won = top_->compare_exchange_strong(
+        t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+    bottom_->store(b + 1, std::memory_order_relaxed);
+    return won;
+  }
+
+  // Steals the top value into x. Returns false if the deque is empty or the
+  // steal lost a race with another thief or the owner.
+  bool steal(T& x) {
+    auto t = top_->load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    auto b = bottom_->load(std::memory_order_acquire);
+    if (t >= b) return false;
+
+    auto a = array_.load(std::memory_order_acquire);
+    x = a->get(t);
+    return top_->compare_exchange_strong(
+        t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+  }
+
+  // Returns true if the deque looked empty at some point during the call.
+  bool empty() const {
+    return bottom_->load(std::memory_order_relaxed) <=
+           top_->load(std::memory_order_relaxed);
+  }
+
+ private:
+  struct Array {
+    explicit Array(std::size_t capacity)
+        : mask{capacity - 1}, buf{new std::atomic<T>[capacity]} {}
+
+    T get(std::int64_t k) const {
+      return buf[static_cast<std::size_t>(k) & mask].load(
+          std::memory_order_relaxed);
+    }
+
+    void put(std::int64_t k, T x) {
+      buf[static_cast<std::size_t>(k) & mask].store(x,
+                                                    std::memory_order_relaxed);
+    }
+
+    std::size_t mask;
+    std::unique_ptr<std::atomic<T>[]> buf;
+  };
+
+  Array* grow(Array* a, std::int64_t t, std::int64_t b) {
+    arrays_.emplace_back(new Array{(a->mask + 1) * 2});
+    auto bigger = arrays_.back().get();
+    for (auto k = t; k < b; k++) bigger->put(k, a->get(k));
+    array_.store(bigger, std::memory_order_release);
+    return bigger;
+  }
+
+  // The indexes are written by different threads (bottom by the owner, top by
+  // thieves) so they are on separate cache lines.
+  CachePadded<std::atomic<std::int64_t>> top_{0};
+  CachePadded<std::atomic<std::int64_t>> bottom_{0};
+  std::atomic<Array*> array_;
+
+  // Thieves may still read from an old array after the owner grew the deque
+  // so old arrays are only freed with the deque.
+  std::vector<std::unique_ptr<Array>> arrays_;
+};
+
+struct Task {
+  virtual ~Task() = default;
+
+  virtual void run() = 0;
+};
+
+template <typename F>
+class FunctionTask : public Task {
+ public:
+  explicit FunctionTask(F f) : f_{std::move(f)} {}
+
+  void run() override { f_(); }
+
+ private:
+  F f_;
+};
+
+struct Worker;
+
+}  // namespace detail
+
+// A pool of workers which each own a Chase-Lev deque. Tasks spawned by a
+// worker are pushed to its own deque and run LIFO which keeps recursive
+// fork-join computations depth first and cache friendly. Idle workers steal
+// the oldest (usually largest) tasks from other workers, trying victims on
+// the same core, then the same package and only then other packages. Tasks
+// spawned by other threads go through a shared injection queue.
+//
+// Tasks MUST NOT throw, use TaskGroup to propagate exceptions.
+class BITS_EXPORT WorkStealingPool {
+ public:
+  // Starts numOfThreads workers placed on the cpus of the topology. Throws
+  // std::runtime_error if the workers can't be pinned.
+  explicit WorkStealingPool(std::size_t numOfThreads,
+                            Placement placement = Placement::kNone,
+                            const CpuTopology& topology = CpuTopology::get());
+
+  WorkStealingPool(const WorkStealingPool&) = delete;
+  WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+  // Runs the remaining tasks and joins the workers.
+  ~WorkStealingPool();
+
+  // Queues f() to run on one of the workers.
+  template <typename F>
+  void spawn(F&& f) {
+    push(new detail::FunctionTask<std::decay_t<F>>{std::forward<F>(f)});
+  }
+
+  // Runs one queued task on the calling thread. Returns false if no task was
+  // found. Threads waiting for tasks call this to help instead of blocking.
+  bool tryRunOne();
+
+  // Returns the number of workers.
+  std::size_t size() const { return workers_.size(); }
+
+ private:
+  void stop();
+
+  void push(detail::Task* task);
+
+  detail::Task* findTask(detail::Worker* self);
+
+  void run(detail::Worker* self);
+
+  std::vector<std::unique_ptr<detail::Worker>> workers_;
+
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::deque<detail::Task*> injected_;
+  std::atomic<std::size_t> numOfInjected_{0};
+  std::atomic<std::size_t> numOfSleepers_{0};
+  // Bumped (under mutex_) by pushes while workers sleep.
+  std::atomic<std::uint64_t> epoch_{0};
+  std::atomic<std::size_t> nextVictim_{0};
+  bool stopped_{false};
+};
+
+// Spawns tasks into a WorkStealingPool and waits for all of them to finish:
+//
+//   TaskGroup group{pool};
+//   group.spawn([&]() { lhs = fib(n - 1); });
+//   rhs = fib(n - 2);
+//   group.wait();
+//
+// Tasks may create groups of their own for recursive fork-join.
+class BITS_EXPORT TaskGroup {
+ public:
+  explicit TaskGroup(WorkStealingPool& pool) : pool_{pool} {}
+
+  TaskGroup(const TaskGroup&) = delete;
+  TaskGroup& operator=(const TaskGroup&) = delete;
+
+  // Waits for the remaining tasks. Exceptions are dropped.
+  ~TaskGroup() {
+    try {
+      wait();
+    } catch (...) {
+    }
+  }
+
+  template <typename F>
+  void spawn(F&& f) {
+    pending_.fetch_add(1, std::memory_order_relaxed);
+    pool_.spawn([this, f = std::forward<F>(f)]() mutable {
+      try {
+        f();
+      } catch (...) {
+        std::lock_guard<std::mutex> lock{mutex_};
+        if (!exception_) exception_ = std::current_exception();
+      }
+      pending_.fetch_sub(1, std::memory_order_release);
+    });
+  }
+
+  // Runs queued tasks of the pool until all tasks spawned by this group have
+  // finished. Rethrows the first exception thrown by a task.
+  void wait();
+
+ private:
+  WorkStealingPool& pool_;
+  std::atomic<std::size_t> pending_{0};
+  std::mutex mutex_;
+  std::exception_ptr exception_;
+};
+
+}  // namespace bits
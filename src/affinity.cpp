@@ -0,0 +1,50 @@
+#include <bits/affinity.hpp>
+
+#include <pthread.h>
+#include <sched.h>
+
+#include <stdexcept>
+
+namespace bits {
+namespace {
+
+void setAffinity(pthread_t thread, std::size_t cpu) {
+#if defined(__linux)
+  ::cpu_set_t cpuset;
+  CPU_ZERO(&cpuset);
+  CPU_SET(cpu, &cpuset);
+
+  auto code = ::pthread_setaffinity_np(thread, sizeof(cpuset), &cpuset);
+  if (code != 0) throw std::runtime_error{"Error setting thread affinity."};
+#else
+  throw std::runtime_error{
+      "Thread affinities are not supported on your platform."};
+#endif
+}
+
+}  // namespace
+
+void pinThread(std::thread& thread, std::size_t cpu) {
+  setAffinity(thread.native_handle(), cpu);
+}
+
+void pinThisThread(std::size_t cpu) { setAffinity(::pthread_self(), cpu); }
+
+std::vector<std::size_t> getAllowedCpus() {
+  std::vector<std::size_t> cpus;
+#if defined(__linux)
+  ::cpu_set_t cpuset;
+  CPU_ZERO(&cpuset);
+  if (::sched_getaffinity(0, sizeof(cpuset), &cpuset) == 0) {
+    for (std::size_t cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+      if (CPU_ISSET(cpu, &cpuset)) cpus.push_back(cpu);
+    }
+    return cpus;
+  }
+#endif
+  for (std::size_t cpu = 0; cpu < std::thread::hardware_concurrency(); cpu++)
+    cpus.push_back(cpu);
+  return cpus;
+}
+
+}  // namespace bits
@@ -0,0 +1,58 @@
+#include <bits/arena.hpp>
+
+#include <algorithm>
+
+namespace bits {
+
+constexpr std::size_t Arena::kDefaultBlockSize;
+
+Arena::Arena(std::size_t blockSize, PageBacking backing)
+    : blockSize_{getMappedSize(blockSize, backing)}, backing_{backing} {}
+
+Arena::~Arena() {
+  for (auto& block : blocks_) unmapPages(block.p, block.size, backing_);
+}
+
+void Arena::reset() {
+  if (blocks_.empty()) return;
+  useBlock(0);
+}
+
+std::size_t Arena::capacity() const {
+  std::size_t n = 0;
+  for (auto& block : blocks_) n += block.size;
+  return n;
+}
+
+void* Arena::allocateSlow(std::size_t size, std::size_t alignment) {
+  if (size > std::numeric_limits<std::size_t>::max() - alignment)
+    throw std::bad_alloc{};
+
+  // Zero bytes fit anywhere, even (just) past the end of the current block.
+  if (size == 0 && !blocks_.empty())
+    return reinterpret_cast<void*>((ptr_ + alignment - 1) & ~(alignment - 1));
+
+  // Try the blocks kept by reset(). Each block is page aligned so it fits the
+  // allocation if it is big enough for size + alignment.
+  while (!blocks_.empty() && current_ + 1 < blocks_.size()) {
+    useBlock(current_ + 1);
+    if (blocks_[current_].size >= size + alignment)
+      return allocate(size, alignment);
+  }
+
+  // Oversized allocations get a block of their own.
+  Block block;
+  block.size = getMappedSize(std::max(blockSize_, size + alignment), backing_);
+  block.p = mapPages(block.size, backing_);
+  blocks_.push_back(block);
+  useBlock(blocks_.size() - 1);
+  return allocate(size, alignment);
+}
+
+void Arena::useBlock(std::size_t index) {
+  current_ = index;
+  ptr_ = reinterpret_cast<std::uintptr_t>(blocks_[index].p);
+  end_ = ptr_ + blocks_[index].size;
+}
+
+}  // namespace bits
@@ -1,11 +1,12 @@
 #include <bits/cacheline.hpp>
 
-#include <chrono>
 #include <cstdint>
 #include <iostream>
 #include <random>
 #include <vector>
 
+#include <bits/tsc_clock.hpp>
+
 namespace bits {
 namespace {
 
@@ -34,15 +35,15 @@ std::vector<std::uint8_t> createRandomVec(std::size_t step) {
   return xs;
 }
 
-std::chrono::high_resolution_clock::duration benchWithStepSize(
-    std::size_t step, volatile std::size_t* doNotOptimize) {
+TscClock::duration benchWithStepSize(std::size_t step,
+                                     volatile std::size_t* doNotOptimize) {
   auto xs = createRandomVec(step);
   std::size_t p = 0;
 
-  auto begin = std::chrono::high_resolution_clock::now();
+  auto begin = TscClock::now();
   for (std::size_t load = 0; load < kNumLoads; load++)
     p = (p + xs[p]) & (kArrayLen - 1);
-  auto loopTime = std::chrono::high_resolution_clock::now() - begin;
+  auto loopTime = TscClock::now() - begin;
 
   // This is mostly just a trick to prevent compiler optimization of the loop.
   *doNotOptimize = p;
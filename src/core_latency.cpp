@@ -0,0 +1,151 @@
+#include <bits/core_latency.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <limits>
+#include <numeric>
+#include <thread>
+
+#include <bits/affinity.hpp>
+#include <bits/cache_padded.hpp>
+#include <bits/tsc_clock.hpp>
+
+namespace bits {
+namespace {
+
+constexpr std::uint64_t kRoundTrips = 100'000;
+constexpr std::size_t kSamples = 5;
+
+// Returns the time (in nanoseconds) of kRoundTrips round trips. The ping
+// thread writes odd values and waits for the next even value which the pong
+// thread writes after seeing the odd value.
+double benchPingPong(std::size_t lhs, std::size_t rhs) {
+  CachePadded<std::atomic<std::uint64_t>> flag{0};
+  std::atomic<int> ready{0};
+
+  // Each thread pins itself so it never runs on the wrong cpu. Exceptions
+  // can't leave a std::thread so pin failures are rethrown after the join.
+  // Returns false if either thread failed to pin itself.
+  std::exception_ptr errors[2];
+  auto pinAndWait = [&ready, &errors](std::size_t k, std::size_t cpu) {
+    try {
+      pinThisThread(cpu);
+    } catch (...) {
+      errors[k] = std::current_exception();
+    }
+    ready.fetch_add(1);
+    while (ready.load() < 2) {
+    }
+    return !errors[0] && !errors[1];
+  };
+
+  std::thread pong{[&flag, &pinAndWait, rhs]() {
+    if (!pinAndWait(1, rhs)) return;
+    for (std::uint64_t k = 0; k < kRoundTrips; k++) {
+      while (flag->load(std::memory_order_acquire) != 2 * k + 1) {
+      }
+      flag->store(2 * k + 2, std::memory_order_release);
+    }
+  }};
+
+  TscClock::duration loopTime;
+  std::thread ping{[&flag, &pinAndWait, &loopTime, lhs]() {
+    if (!pinAndWait(0, lhs)) return;
+    auto begin = TscClock::now();
+    for (std::uint64_t k = 0; k < kRoundTrips; k++) {
+      flag->store(2 * k + 1, std::memory_order_release);
+      while (flag->load(std::memory_order_acquire) != 2 * k + 2) {
+      }
+    }
+    loopTime = TscClock::now() - begin;
+  }};
+
+  ping.join();
+  pong.join();
+  for (auto& error : errors) {
+    if (error) std::rethrow_exception(error);
+  }
+
+  return std::chrono::duration<double, std::nano>(loopTime).count();
+}
+
+// Union-find (disjoint set) over indexes [0, n).
+class DisjointSets {
+ public:
+  explicit DisjointSets(std::size_t n) : parents_(n) {
+    std::iota(parents_.begin(), parents_.end(), 0);
+  }
+
+  std::size_t find(std::size_t k) {
+    while (parents_[k] != k) k = parents_[k] = parents_[parents_[k]];
+    return k;
+  }
+
+  void merge(std::size_t lhs, std::size_t rhs) {
+    parents_[find(lhs)] = find(rhs);
+  }
+
+ private:
+  std::vector<std::size_t> parents_;
+};
+
+}  // namespace
+
+double measureCoreLatency(std::size_t lhs, std::size_t rhs) {
+  // The minimum of a few samples filters out interference from interrupts and
+  // other processes.
+  auto ns = std::numeric_limits<double>::max();
+  for (std::size_t sample = 0; sample < kSamples; sample++)
+    ns = std::min(ns, benchPingPong(lhs, rhs));
+  return ns / kRoundTrips;
+}
+
+CoreLatencies measureCoreLatencies(const std::vector<std::size_t>& cpus) {
+  CoreLatencies latencies{cpus, {}};
+  latencies.ns.assign(cpus.size(), std::vector<double>(cpus.size(), 0));
+  for (std::size_t i = 0; i < cpus.size(); i++) {
+    for (std::size_t j = i + 1; j < cpus.size(); j++) {
+      latencies.ns[i][j] = latencies.ns[j][i] =
+          measureCoreLatency(cpus[i], cpus[j]);
+    }
+  }
+  return latencies;
+}
+
+std::vector<std::vector<std::size_t>> getLatencyDomains(
+    const CoreLatencies& latencies, double threshold) {
+  auto n = latencies.cpus.size();
+
+  auto minNs = std::numeric_limits<double>::max();
+  for (std::size_t i = 0; i < n; i++) {
+    for (std::size_t j = i + 1; j < n; j++)
+      minNs = std::min(minNs, latencies.ns[i][j]);
+  }
+
+  DisjointSets sets{n};
+  for (std::size_t i = 0; i < n; i++) {
+    for (std::size_t j = i + 1; j < n; j++) {
+      if (latencies.ns[i][j] <= minNs * threshold) sets.merge(i, j);
+    }
+  }
+
+  std::vector<std::vector<std::size_t>> domains;
+  std::vector<std::size_t> domainOfSet(n, n);
+  for (std::size_t k = 0; k < n; k++) {
+    auto set = sets.find(k);
+    if (domainOfSet[set] == n) {
+      domainOfSet[set] = domains.size();
+      domains.emplace_back();
+    }
+    domains[domainOfSet[set]].push_back(latencies.cpus[k]);
+  }
+
+  for (auto& domain : domains) std::sort(domain.begin(), domain.end());
+  std::sort(domains.begin(), domains.end());
+  return domains;
+}
+
+}  // namespace bits
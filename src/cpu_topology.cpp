@@ -0,0 +1,325 @@
+#include <bits/cpu_topology.hpp>
+
+#include <dirent.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <exception>
+#include <fstream>
+#include <limits>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+
+#include <boost/optional.hpp>
+
+#include <bits/affinity.hpp>
+#include <bits/tsc_clock.hpp>
+
+namespace bits {
+namespace {
+
+// The workload is sized to stay in the L1 cache so it is bound by the
+// throughput of the (shared) sqrt unit rather than memory bandwidth, which
+// would make all cpus slow each other down.
+constexpr std::size_t kBufLen = 1024;
+constexpr std::size_t kPasses = 4096;
+constexpr std::size_t kSamples = 3;
+
+// Siblings are cpus which slow each other down by more than 25%.
+constexpr double kThresh = 1.25;
+
+const std::string kCpuDir = "/sys/devices/system/cpu/";
+const std::string kNodeDir = "/sys/devices/system/node/";
+
+boost::optional<std::string> readLine(const std::string& path) {
+  std::ifstream in{path};
+  std::string line;
+  if (!std::getline(in, line)) return boost::none;
+  return line;
+}
+
+boost::optional<std::size_t> readSize(const std::string& path) {
+  std::ifstream in{path};
+  std::size_t v;
+  if (!(in >> v)) return boost::none;
+  return v;
+}
+
+// Maps cpus to their NUMA node via /sys/devices/system/node/node*/cpulist.
+std::map<std::size_t, std::size_t> readNodes() {
+  std::map<std::size_t, std::size_t> nodes;
+  auto dir = ::opendir(kNodeDir.c_str());
+  if (!dir) return nodes;
+
+  while (auto entry = ::readdir(dir)) {
+    std::string name{entry->d_name};
+    if (name.compare(0, 4, "node") != 0 || name.size() == 4 ||
+        name.find_first_not_of("0123456789", 4) != std::string::npos)
+      continue;
+    auto list = readLine(kNodeDir + name + "/cpulist");
+    if (!list) continue;
+    auto node = std::stoul(name.substr(4));
+    try {
+      for (auto cpu : parseCpuList(*list)) nodes[cpu] = node;
+    } catch (const std::invalid_argument&) {
+    }
+  }
+
+  ::closedir(dir);
+  return nodes;
+}
+
+// Returns boost::none if the topology of any of the cpus is missing.
+boost::optional<CpuTopology> readSysfs(const std::vector<std::size_t>& cpus) {
+  auto nodes = readNodes();
+  std::map<std::pair<std::size_t, std::size_t>, std::size_t> cores;
+  std::vector<CpuInfo> infos;
+  for (auto cpu : cpus) {
+    auto dir = kCpuDir + "cpu" + std::to_string(cpu) + "/topology/";
+    auto package = readSize(dir + "physical_package_id");
+    auto coreId = readSize(dir + "core_id");
+    if (!package || !coreId) return boost::none;
+
+    // Core ids are only unique within a package and not necessarily dense.
+    auto core = cores.emplace(std::make_pair(*package, *coreId), cores.size())
+                    .first->second;
+    auto node = nodes.find(cpu);
+    infos.push_back(
+        CpuInfo{cpu, core, *package, node != nodes.end() ? node->second : 0});
+  }
+  return CpuTopology{std::move(infos)};
+}
+
+// Finds the cpu in a range of cpus sorted by cpu. Returns end if not found.
+template <typename It>
+It findCpu(It begin, It end, std::size_t cpu) {
+  auto it = std::lower_bound(
+      begin, end, cpu,
+      [](const CpuInfo& info, std::size_t cpu) { return info.cpu < cpu; });
+  return it != end && it->cpu == cpu ? it : end;
+}
+
+void runWorkload(double* buf) {
+  for (std::size_t pass = 0; pass < kPasses; pass++) {
+    for (auto p = buf; p < buf + kBufLen; p++) *p = std::sqrt(*p) + 1.0;
+  }
+}
+
+// Runs the workload on all cpus at the same time and returns the time each cpu
+// took in seconds. Each thread times itself so stragglers starting late don't
+// affect the others. Throws std::runtime_error if a thread can't be pinned.
+std::vector<double> timeWorkload(const std::vector<std::size_t>& cpus) {
+  std::vector<double> times(cpus.size(), std::numeric_limits<double>::max());
+
+  for (std::size_t sample = 0; sample < kSamples; sample++) {
+    std::atomic<std::size_t> ready{0};
+    // Exceptions can't leave a std::thread so pin failures are rethrown after
+    // the join. Threads still wait for each other so none of them spins
+    // forever.
+    std::vector<std::exception_ptr> errors(cpus.size());
+    std::atomic<bool> failed{false};
+    std::vector<std::thread> threads;
+    for (std::size_t k = 0; k < cpus.size(); k++) {
+      threads.emplace_back([&cpus, &times, &ready, &errors, &failed, k]() {
+        try {
+          pinThisThread(cpus[k]);
+        } catch (...) {
+          errors[k] = std::current_exception();
+          failed.store(true);
+        }
+        std::vector<double> buf(kBufLen);
+        for (std::size_t i = 0; i < kBufLen; i++) buf[i] = i;
+
+        ready.fetch_add(1);
+        while (ready.load() < cpus.size()) {
+        }
+        if (failed.load()) return;
+
+        auto begin = TscClock::now();
+        runWorkload(buf.data());
+        std::chrono::duration<double> t = TscClock::now() - begin;
+        times[k] = std::min(times[k], t.count());
+
+        // Keep the compiler from optimizing the workload away.
+        volatile double sink = buf[0];
+        (void)sink;
+      });
+    }
+    for (auto& thread : threads) thread.join();
+    for (auto& error : errors) {
+      if (error) std::rethrow_exception(error);
+    }
+  }
+
+  return times;
+}
+
+// Runs the workload on one cpu of each core and then on all cpus of cores with
+// siblings. Cpus which are not slowed down are moved to cores of their own.
+CpuTopology verifySiblings(const CpuTopology& topology) {
+  auto cores = topology.cores();
+
+  std::vector<std::size_t> firsts;
+  std::vector<std::size_t> shared;
+  for (const auto& core : cores) {
+    firsts.push_back(core.front());
+    if (core.size() > 1) shared.insert(shared.end(), core.begin(), core.end());
+  }
+  if (shared.empty()) return topology;
+
+  auto base = timeWorkload(firsts);
+  auto loaded = timeWorkload(shared);
+
+  auto infos = topology.cpus();
+  auto nextCore = cores.size();
+
+  std::size_t offset = 0;
+  for (std::size_t c = 0; c < cores.size(); c++) {
+    const auto& core = cores[c];
+    if (core.size() == 1) continue;
+
+    double ratio = 0;
+    for (std::size_t k = 0; k < core.size(); k++)
+      ratio += loaded[offset + k] / base[c];
+    ratio /= core.size();
+    offset += core.size();
+
+    if (ratio > kThresh) continue;
+    for (std::size_t k = 1; k < core.size(); k++)
+      findCpu(infos.begin(), infos.end(), core[k])->core = nextCore++;
+  }
+
+  return CpuTopology{std::move(infos)};
+}
+
+// Times the workload on all pairs of cpus which are not known to be siblings
+// yet, one pair at a time. Unlike verifySiblings(...) this can't run disjoint
+// pairs in parallel: without a topology to start from, a cpu may be slowed
+// down by an (unknown) sibling in another pair of the same round, which is
+// indistinguishable from being slowed down by its own pair. Cpus are skipped
+// once assigned to a core, so this is O(cores * cpus) probes. Only used when
+// sysfs is unavailable.
+CpuTopology discoverSiblings(const std::vector<std::size_t>& cpus) {
+  auto n = cpus.size();
+  std::vector<std::size_t> cores(n, n);
+  std::size_t nextCore = 0;
+
+  for (std::size_t i = 0; i < n; i++) {
+    if (cores[i] != n) continue;
+    cores[i] = nextCore++;
+    auto base = timeWorkload({cpus[i]}).front();
+    for (std::size_t j = i + 1; j < n; j++) {
+      if (cores[j] != n) continue;
+      auto t = timeWorkload({cpus[i], cpus[j]});
+      if ((t[0] + t[1]) / 2 / base > kThresh) cores[j] = cores[i];
+    }
+  }
+
+  std::vector<CpuInfo> infos;
+  for (std::size_t k = 0; k < n; k++)
+    infos.push_back(CpuInfo{cpus[k], cores[k], 0, 0});
+  return CpuTopology{std::move(infos)};
+}
+
+template <typename F>
+CpuTopology::Groups groupBy(const std::vector<CpuInfo>& cpus, F&& key) {
+  std::map<std::size_t, std::vector<std::size_t>> groups;
+  for (const auto& info : cpus) groups[key(info)].push_back(info.cpu);
+
+  CpuTopology::Groups sorted;
+  for (auto& group : groups) sorted.push_back(std::move(group.second));
+  return sorted;
+}
+
+}  // namespace
+
+CpuTopology::CpuTopology(std::vector<CpuInfo> cpus) : cpus_{std::move(cpus)} {
+  std::sort(cpus_.begin(), cpus_.end(),
+            [](const CpuInfo& lhs, const CpuInfo& rhs) {
+              return lhs.cpu < rhs.cpu;
+            });
+}
+
+CpuTopology CpuTopology::read() {
+  auto cpus = getAllowedCpus();
+  auto topology = readSysfs(cpus);
+  if (topology) return *topology;
+
+  std::vector<CpuInfo> infos;
+  for (std::size_t k = 0; k < cpus.size(); k++)
+    infos.push_back(CpuInfo{cpus[k], k, 0, 0});
+  return CpuTopology{std::move(infos)};
+}
+
+CpuTopology CpuTopology::probe() {
+  auto cpus = getAllowedCpus();
+  auto topology = readSysfs(cpus);
+  if (topology) return verifySiblings(*topology);
+  return discoverSiblings(cpus);
+}
+
+const CpuTopology& CpuTopology::get() {
+  static const auto kTopology = read();
+  return kTopology;
+}
+
+CpuTopology::Groups CpuTopology::packages() const {
+  return groupBy(cpus_, [](const CpuInfo& info) { return info.package; });
+}
+
+CpuTopology::Groups CpuTopology::cores() const {
+  // Cores are keyed by their smallest cpu so they are sorted the same way.
+  std::map<std::size_t, std::size_t> firstCpu;
+  for (const auto& info : cpus_) firstCpu.emplace(info.core, info.cpu);
+  return groupBy(cpus_, [&firstCpu](const CpuInfo& info) {
+    return firstCpu[info.core];
+  });
+}
+
+CpuTopology::Groups CpuTopology::nodes() const {
+  return groupBy(cpus_, [](const CpuInfo& info) { return info.node; });
+}
+
+std::vector<std::size_t> CpuTopology::siblings(std::size_t cpu) const {
+  std::vector<std::size_t> siblings;
+  auto it = findCpu(cpus_.begin(), cpus_.end(), cpu);
+  if (it == cpus_.end()) return siblings;
+
+  for (const auto& info : cpus_) {
+    if (info.core == it->core && info.cpu != cpu) siblings.push_back(info.cpu);
+  }
+  return siblings;
+}
+
+std::vector<std::size_t> parseCpuList(const std::string& list) {
+  std::vector<std::size_t> cpus;
+  std::istringstream in{list};
+  std::string range;
+  while (std::getline(in, range, ',')) {
+    if (range.empty()) continue;
+    auto dash = range.find('-');
+    try {
+      std::size_t end;
+      auto first = std::stoul(range, &end);
+      auto last = first;
+      if (dash != std::string::npos) {
+        if (end != dash) throw std::invalid_argument{range};
+        last = std::stoul(range.substr(dash + 1), &end);
+        end += dash + 1;
+      }
+      if (end != range.size() || last < first)
+        throw std::invalid_argument{range};
+      for (auto cpu = first; cpu <= last; cpu++) cpus.push_back(cpu);
+    } catch (const std::logic_error&) {
+      throw std::invalid_argument{"Invalid cpu list: " + list};
+    }
+  }
+  return cpus;
+}
+
+}  // namespace bits
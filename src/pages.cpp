@@ -0,0 +1,138 @@
+#include <bits/pages.hpp>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+
+#include <boost/optional.hpp>
+
+namespace bits {
+namespace {
+
+constexpr std::size_t kDefaultHugePageSize = 2 * 1024 * 1024;
+
+std::size_t roundUp(std::size_t n, std::size_t multiple) {
+  return (n + multiple - 1) / multiple * multiple;
+}
+
+// Looks up the value of a "Key: value [kB]" entry in /proc/meminfo.
+boost::optional<std::size_t> readMemInfo(const std::string& key) {
+  std::ifstream in{"/proc/meminfo"};
+  std::string k;
+  std::size_t v;
+  std::string unit;
+  while (in >> k >> v) {
+    std::getline(in, unit);
+    if (k == key + ":") return v;
+  }
+  return boost::none;
+}
+
+// Maps size bytes aligned to alignment. The mapping is over-sized by alignment
+// bytes and then trimmed so munmap(...) of exactly size bytes works later.
+void* mapAligned(std::size_t size, std::size_t alignment) {
+  auto len = size + alignment;
+  auto p = ::mmap(nullptr, len, PROT_READ | PROT_WRITE,
+                  MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (p == MAP_FAILED) throw std::bad_alloc{};
+
+  auto begin = reinterpret_cast<std::uintptr_t>(p);
+  auto aligned = roundUp(begin, alignment);
+  if (aligned > begin) ::munmap(p, aligned - begin);
+  auto end = begin + len;
+  if (end > aligned + size)
+    ::munmap(reinterpret_cast<void*>(aligned + size), end - aligned - size);
+
+  return reinterpret_cast<void*>(aligned);
+}
+
+}  // namespace
+
+std::size_t getPageSize() {
+  static const auto kPageSize =
+      static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+  return kPageSize;
+}
+
+std::size_t getHugePageSize() {
+  static const auto kHugePageSize = []() -> std::size_t {
+    auto kb = readMemInfo("Hugepagesize");
+    return kb ? *kb * 1024 : kDefaultHugePageSize;
+  }();
+  return kHugePageSize;
+}
+
+bool isPageBackingAvailable(PageBacking backing) {
+  switch (backing) {
+    case PageBacking::kRegular:
+      return true;
+    case PageBacking::kTransparent: {
+      std::ifstream in{"/sys/kernel/mm/transparent_hugepage/enabled"};
+      std::string mode;
+      while (in >> mode) {
+        if (mode == "[always]" || mode == "[madvise]") return true;
+      }
+      return false;
+    }
+    case PageBacking::kExplicit: {
+      auto free = readMemInfo("HugePages_Free");
+      return free && *free > 0;
+    }
+  }
+  return false;
+}
+
+std::size_t getMappedSize(std::size_t size, PageBacking backing) {
+  auto multiple = backing == PageBacking::kRegular ? getPageSize()
+                                                   : getHugePageSize();
+  return roundUp(size > 0 ? size : 1, multiple);
+}
+
+void* mapPages(std::size_t size, PageBacking backing, PageBacking* actual) {
+  auto len = getMappedSize(size, backing);
+
+  if (backing == PageBacking::kExplicit) {
+#if defined(MAP_HUGETLB)
+    auto p = ::mmap(nullptr, len, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (p != MAP_FAILED) {
+      if (actual) *actual = PageBacking::kExplicit;
+      return p;
+    }
+#endif
+    // Most likely the hugetlbfs pool is empty (or exhausted).
+    backing = PageBacking::kTransparent;
+  }
+
+  // Transparent huge pages are only used for huge page aligned regions.
+  auto alignment = backing == PageBacking::kRegular ? getPageSize()
+                                                    : getHugePageSize();
+  auto p = mapAligned(len, alignment);
+
+  if (backing == PageBacking::kTransparent) {
+#if defined(MADV_HUGEPAGE)
+    // The madvise(...) succeeds even when THP is disabled system wide.
+    if (!isPageBackingAvailable(PageBacking::kTransparent) ||
+        ::madvise(p, len, MADV_HUGEPAGE) != 0)
+      backing = PageBacking::kRegular;
+#else
+    backing = PageBacking::kRegular;
+#endif
+  }
+
+#if defined(MADV_NOHUGEPAGE)
+  if (backing == PageBacking::kRegular) ::madvise(p, len, MADV_NOHUGEPAGE);
+#endif
+
+  if (actual) *actual = backing;
+  return p;
+}
+
+void unmapPages(void* p, std::size_t size, PageBacking backing) {
+  if (p) ::munmap(p, getMappedSize(size, backing));
+}
+
+}  // namespace bits
@@ -0,0 +1,16 @@
+#include <bits/statics.hpp>
+
+// Compiled once per TLS variant (see meson.build) with BITS_STATICS_TL set to
+// the name of the variant's Statics::getTL...() getter.
+namespace bits {
+namespace {
+
+thread_local char c = 'c';
+
+}  // namespace
+
+void* Statics::BITS_STATICS_TL() {
+  return &c;
+}
+
+}  // namespace bits
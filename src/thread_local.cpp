@@ -0,0 +1,126 @@
+#include <bits/thread_local.hpp>
+
+#include <algorithm>
+#include <memory>
+
+namespace bits {
+namespace detail {
+
+thread_local ThreadLocalEntry* tlsThreadLocalEntry = nullptr;
+
+namespace {
+
+struct Registry {
+  std::recursive_mutex mutex;
+  std::size_t nextId = 0;
+  std::vector<std::size_t> freeIds;
+  std::vector<ThreadLocalEntry*> entries;
+};
+
+Registry& getRegistry() {
+  // Leaked so threads exiting after static destruction can still unregister.
+  static auto registry = new Registry{};
+  return *registry;
+}
+
+void disposeAll(const std::vector<ThreadLocalElement>& elements) {
+  for (auto& element : elements) element.dispose(element.p);
+}
+
+// Owns the entry of a thread and disposes its values when the thread exits.
+struct EntryOwner {
+  EntryOwner() {
+    auto& registry = getRegistry();
+    std::lock_guard<std::recursive_mutex> lock{registry.mutex};
+    registry.entries.push_back(&entry);
+    tlsThreadLocalEntry = &entry;
+  }
+
+  ~EntryOwner() {
+    auto& registry = getRegistry();
+    std::vector<ThreadLocalElement> elements;
+    {
+      std::lock_guard<std::recursive_mutex> lock{registry.mutex};
+      registry.entries.erase(std::find(registry.entries.begin(),
+                                       registry.entries.end(), &entry));
+      for (std::size_t id = 0; id < entry.capacity; id++) {
+        if (entry.elements[id].p) elements.push_back(entry.elements[id]);
+      }
+    }
+    tlsThreadLocalEntry = nullptr;
+    storage.reset();
+    disposeAll(elements);
+  }
+
+  ThreadLocalEntry entry;
+  std::unique_ptr<ThreadLocalElement[]> storage;
+};
+
+EntryOwner& getOwner() {
+  static thread_local EntryOwner owner;
+  return owner;
+}
+
+}  // namespace
+
+std::size_t ThreadLocalRegistry::acquireId() {
+  auto& registry = getRegistry();
+  std::lock_guard<std::recursive_mutex> lock{registry.mutex};
+  if (registry.freeIds.empty()) return registry.nextId++;
+  auto id = registry.freeIds.back();
+  registry.freeIds.pop_back();
+  return id;
+}
+
+void ThreadLocalRegistry::releaseId(std::size_t id) {
+  auto& registry = getRegistry();
+  std::vector<ThreadLocalElement> elements;
+  {
+    std::lock_guard<std::recursive_mutex> lock{registry.mutex};
+    for (auto entry : registry.entries) {
+      if (id < entry->capacity && entry->elements[id].p) {
+        elements.push_back(entry->elements[id]);
+        entry->elements[id] = ThreadLocalElement{};
+      }
+    }
+    registry.freeIds.push_back(id);
+  }
+  disposeAll(elements);
+}
+
+void ThreadLocalRegistry::set(std::size_t id, void* p,
+                              void (*dispose)(void*)) {
+  auto& owner = getOwner();
+  auto& entry = owner.entry;
+  auto& registry = getRegistry();
+  std::lock_guard<std::recursive_mutex> lock{registry.mutex};
+
+  if (id >= entry.capacity) {
+    // Grow geometrically, ids are dense so this stays small.
+    auto capacity = std::max(2 * entry.capacity, id + 1);
+    std::unique_ptr<ThreadLocalElement[]> elements{
+        new ThreadLocalElement[capacity]};
+    std::copy(entry.elements, entry.elements + entry.capacity, elements.get());
+    owner.storage = std::move(elements);
+    entry.elements = owner.storage.get();
+    entry.capacity = capacity;
+  }
+
+  entry.elements[id] = ThreadLocalElement{p, dispose};
+}
+
+std::vector<void*> ThreadLocalRegistry::getAll(std::size_t id) {
+  std::vector<void*> values;
+  for (auto entry : getRegistry().entries) {
+    if (id < entry->capacity && entry->elements[id].p)
+      values.push_back(entry->elements[id].p);
+  }
+  return values;
+}
+
+std::recursive_mutex& ThreadLocalRegistry::getMutex() {
+  return getRegistry().mutex;
+}
+
+}  // namespace detail
+}  // namespace bits
@@ -0,0 +1,142 @@
+#include <bits/thread_pool.hpp>
+
+#include <algorithm>
+#include <map>
+
+#include <bits/affinity.hpp>
+
+namespace bits {
+namespace {
+
+// Orders the cpus of a package by the rank of the cpu within its core so all
+// first siblings come before all second siblings, etc.
+std::vector<std::size_t> orderBySibling(
+    const std::vector<std::vector<std::size_t>>& cores) {
+  std::vector<std::size_t> cpus;
+  for (std::size_t rank = 0;; rank++) {
+    auto found = false;
+    for (const auto& core : cores) {
+      if (rank >= core.size()) continue;
+      cpus.push_back(core[rank]);
+      found = true;
+    }
+    if (!found) return cpus;
+  }
+}
+
+// Groups the cores of the topology by package.
+std::vector<CpuTopology::Groups> getCoresOfPackages(
+    const CpuTopology& topology) {
+  std::map<std::size_t, std::size_t> packageOfCpu;
+  for (const auto& info : topology.cpus())
+    packageOfCpu[info.cpu] = info.package;
+
+  std::map<std::size_t, CpuTopology::Groups> packages;
+  for (auto& core : topology.cores())
+    packages[packageOfCpu[core.front()]].push_back(std::move(core));
+
+  std::vector<CpuTopology::Groups> sorted;
+  for (auto& package : packages) sorted.push_back(std::move(package.second));
+  return sorted;
+}
+
+}  // namespace
+
+std::vector<std::size_t> placeThreads(const CpuTopology& topology,
+                                      Placement placement,
+                                      std::size_t numOfThreads) {
+  std::vector<std::size_t> order;
+  auto packages = getCoresOfPackages(topology);
+  switch (placement) {
+    case Placement::kNone:
+      return order;
+    case Placement::kPhysicalCores:
+      for (const auto& package : packages) {
+        for (const auto& core : package) order.push_back(core.front());
+      }
+      break;
+    case Placement::kCompact:
+      for (const auto& package : packages) {
+        for (const auto& core : package)
+          order.insert(order.end(), core.begin(), core.end());
+      }
+      break;
+    case Placement::kScatter: {
+      std::vector<std::vector<std::size_t>> cpusOfPackages;
+      std::size_t maxCpus = 0;
+      for (const auto& package : packages) {
+        cpusOfPackages.push_back(orderBySibling(package));
+        maxCpus = std::max(maxCpus, cpusOfPackages.back().size());
+      }
+      for (std::size_t k = 0; k < maxCpus; k++) {
+        for (const auto& cpus : cpusOfPackages) {
+          if (k < cpus.size()) order.push_back(cpus[k]);
+        }
+      }
+      break;
+    }
+  }
+
+  std::vector<std::size_t> cpus;
+  for (std::size_t k = 0; k < numOfThreads && !order.empty(); k++)
+    cpus.push_back(order[k % order.size()]);
+  return cpus;
+}
+
+ThreadPool::ThreadPool(std::size_t numOfThreads, Placement placement,
+                       const CpuTopology& topology)
+    : cpus_{placeThreads(topology, placement, numOfThreads)} {
+  start(numOfThreads);
+}
+
+ThreadPool::ThreadPool(const std::vector<std::size_t>& cpus) : cpus_{cpus} {
+  start(cpus.size());
+}
+
+ThreadPool::~ThreadPool() { stop(); }
+
+void ThreadPool::stop() {
+  {
+    std::lock_guard<std::mutex> lock{mutex_};
+    stopped_ = true;
+  }
+  cv_.notify_all();
+  for (auto& thread : threads_) thread.join();
+}
+
+void ThreadPool::start(std::size_t numOfThreads) {
+  try {
+    for (std::size_t k = 0; k < numOfThreads; k++) {
+      threads_.emplace_back([this]() { run(); });
+      if (!cpus_.empty()) pinThread(threads_.back(), cpus_[k]);
+    }
+  } catch (...) {
+    // The destructor doesn't run if the constructor throws.
+    stop();
+    throw;
+  }
+}
+
+void ThreadPool::post(std::function<void()> task) {
+  {
+    std::lock_guard<std::mutex> lock{mutex_};
+    tasks_.push_back(std::move(task));
+  }
+  cv_.notify_one();
+}
+
+void ThreadPool::run() {
+  while (true) {
+    std::function<void()> task;
+    {
+      std::unique_lock<std::mutex> lock{mutex_};
+      cv_.wait(lock, [this]() { return stopped_ || !tasks_.empty(); });
+      if (tasks_.empty()) return;
+      task = std::move(tasks_.front());
+      tasks_.pop_front();
+    }
+    task();
+  }
+}
+
+}  // namespace bits
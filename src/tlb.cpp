@@ -0,0 +1,140 @@
+#include <bits/tlb.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include <bits/pages.hpp>
+#include <bits/tsc_clock.hpp>
+
+namespace bits {
+namespace {
+
+// MUST be powers of two.
+constexpr std::size_t kMinPages = 8;
+constexpr std::size_t kMaxPages = 8 * 1024;
+constexpr std::size_t kNumLoads = 512 * 1024;
+constexpr std::size_t kLineSize = 64;
+constexpr std::size_t kRepetitions = 7;
+constexpr double kThresh = 1.25;
+
+// Owns a mapping returned by mapPages(...).
+class Mapping {
+ public:
+  Mapping(std::size_t size, PageBacking backing)
+      : size_{size},
+        backing_{backing},
+        p_{static_cast<char*>(mapPages(size, backing))} {}
+  Mapping(const Mapping&) = delete;
+  Mapping& operator=(const Mapping&) = delete;
+  ~Mapping() { unmapPages(p_, size_, backing_); }
+
+  char* get() const { return p_; }
+
+ private:
+  std::size_t size_;
+  PageBacking backing_;
+  char* p_;
+};
+
+// Links the slots into a randomly ordered cycle of pointers. Randomizing the
+// order defeats the hardware prefetcher so each load pays the full TLB cost.
+void* linkRandomCycle(std::vector<void**> slots,
+                      std::default_random_engine& eng) {
+  std::shuffle(slots.begin(), slots.end(), eng);
+  for (std::size_t k = 0; k < slots.size(); k++)
+    *slots[k] = slots[(k + 1) % slots.size()];
+  return slots[0];
+}
+
+TscClock::duration benchWalk(void* start,
+                             volatile std::uintptr_t* doNotOptimize) {
+  auto p = start;
+
+  auto begin = TscClock::now();
+  for (std::size_t load = 0; load < kNumLoads; load++)
+    p = *static_cast<void**>(p);
+  auto loopTime = TscClock::now() - begin;
+
+  // This is mostly just a trick to prevent compiler optimization of the loop.
+  *doNotOptimize = reinterpret_cast<std::uintptr_t>(p);
+  return loopTime;
+}
+
+// Returns the slowdown of loading one cache line from each of n pages vs.
+// loading n cache lines packed into as few pages as possible. Both walks touch
+// the same number of cache lines so the slowdown is mostly due to TLB misses.
+double benchSlowdown(const Mapping& pages, const Mapping& lines, std::size_t n,
+                     std::default_random_engine& eng) {
+  // Load from a random line in each page. Otherwise all loads map to the same
+  // L1 cache set and we would measure cache conflict misses instead.
+  std::uniform_int_distribution<std::size_t> dist{
+      0, getPageSize() / kLineSize - 1};
+  std::vector<void**> pageSlots;
+  std::vector<void**> lineSlots;
+  for (std::size_t k = 0; k < n; k++) {
+    auto pageSlot = pages.get() + k * getPageSize() + dist(eng) * kLineSize;
+    pageSlots.push_back(reinterpret_cast<void**>(pageSlot));
+    lineSlots.push_back(reinterpret_cast<void**>(lines.get() + k * kLineSize));
+  }
+
+  volatile std::uintptr_t doNotOptimize;
+  auto pagesStart = linkRandomCycle(pageSlots, eng);
+  auto linesStart = linkRandomCycle(lineSlots, eng);
+  auto pagesTime = TscClock::duration::max();
+  auto linesTime = TscClock::duration::max();
+  for (std::size_t rep = 0; rep < kRepetitions; rep++) {
+    pagesTime = std::min(pagesTime, benchWalk(pagesStart, &doNotOptimize));
+    linesTime = std::min(linesTime, benchWalk(linesStart, &doNotOptimize));
+  }
+
+  return static_cast<double>(pagesTime.count()) / linesTime.count();
+}
+
+}  // namespace
+
+boost::optional<TlbReach> getTlbReach() {
+  static auto kTlbReach = []() -> boost::optional<TlbReach> {
+    std::random_device r;
+    std::default_random_engine eng{r()};
+
+    // Pack the lines into huge pages (if available) so the baseline walk
+    // doesn't miss in the TLB itself.
+    Mapping pages{kMaxPages * getPageSize(), PageBacking::kRegular};
+    Mapping lines{kMaxPages * kLineSize, PageBacking::kTransparent};
+
+    std::vector<double> slowdowns;
+    for (std::size_t n = kMinPages; n <= kMaxPages; n *= 2)
+      slowdowns.push_back(benchSlowdown(pages, lines, n, eng));
+
+    // Look for the first two jumps in slowdown when doubling the number of
+    // pages: L1 dTLB and STLB capacity misses. The slowdown is compared with
+    // the worst slowdown so far because cache effects on the baseline walk
+    // make the slowdown noisy. Once a TLB is exhausted more pages can only be
+    // slower so a jump must persist to filter out noise.
+    boost::optional<TlbReach> reach;
+    auto peak = slowdowns[0];
+    for (std::size_t k = 1; k < slowdowns.size(); k++) {
+      auto jump = slowdowns[k] > peak * kThresh &&
+                  (k + 1 == slowdowns.size() ||
+                   slowdowns[k + 1] > peak * kThresh);
+      if (jump) {
+        auto entries = kMinPages << (k - 1);
+        if (!reach) {
+          reach = TlbReach{getPageSize(), entries, boost::none};
+        } else {
+          reach->l2Entries = entries;
+          break;
+        }
+      }
+      peak = std::max(peak, slowdowns[k]);
+    }
+
+    return reach;
+  }();
+
+  return kTlbReach;
+}
+
+}  // namespace bits
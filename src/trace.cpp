@@ -0,0 +1,104 @@
+#include <bits/trace.hpp>
+
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <iomanip>
+#include <ostream>
+#include <sstream>
+
+namespace bits {
+namespace detail {
+
+int getTraceThreadId() { return static_cast<int>(::syscall(SYS_gettid)); }
+
+void TraceBuffer::snapshot(std::vector<TraceEvent>& events) const {
+  // The slot after head may be being overwritten by the next event so only
+  // kTraceBufferSize - 1 events are readable.
+  auto head = head_.load(std::memory_order_acquire);
+  auto first = head >= kTraceBufferSize ? head - kTraceBufferSize + 1 : 0;
+  auto size = events.size();
+  for (auto n = first; n < head; n++) {
+    auto& record = records_[n & (kTraceBufferSize - 1)];
+    events.push_back(TraceEvent{record.name.load(std::memory_order_relaxed),
+                                record.begin.load(std::memory_order_relaxed),
+                                record.end.load(std::memory_order_relaxed),
+                                record.arg.load(std::memory_order_relaxed),
+                                tid_});
+  }
+
+  // The writer stored head n before overwriting the slot of event
+  // n - kTraceBufferSize so if we read any of those stores we now see head >=
+  // n. Drop events whose slot may have been (partially) overwritten.
+  std::atomic_thread_fence(std::memory_order_acquire);
+  auto newHead = head_.load(std::memory_order_relaxed);
+  if (newHead >= first + kTraceBufferSize) {
+    auto dropped =
+        std::min(newHead - first - kTraceBufferSize + 1, head - first);
+    events.erase(events.begin() + static_cast<std::ptrdiff_t>(size),
+                 events.begin() + static_cast<std::ptrdiff_t>(size + dropped));
+  }
+}
+
+namespace {
+
+void writeJsonString(std::ostream& out, const char* s) {
+  out << '"';
+  for (; *s; s++) {
+    if (*s == '"' || *s == '\\') out << '\\';
+    out << *s;
+  }
+  out << '"';
+}
+
+}  // namespace
+}  // namespace detail
+
+void Tracer::dump(std::ostream& out) {
+  std::vector<detail::TraceEvent> events;
+  {
+    // Keeps threads (and their buffers) alive while copying.
+    auto buffers = getBuffers().accessAllThreads();
+    for (auto& buffer : buffers) buffer.snapshot(events);
+  }
+  std::sort(events.begin(), events.end(),
+            [](const detail::TraceEvent& lhs, const detail::TraceEvent& rhs) {
+              return lhs.begin < rhs.begin;
+            });
+
+  // Timestamps are in us on the steady_clock timeline.
+  auto& calibration = TscClock::getCalibration();
+  auto toUs = [&calibration](std::uint64_t ticks) {
+    auto delta = static_cast<std::int64_t>(ticks - calibration.tick0);
+    return (static_cast<double>(delta) * calibration.nsPerTick +
+            static_cast<double>(calibration.ns0)) /
+           1000;
+  };
+
+  std::ostringstream json;
+  json << std::fixed << std::setprecision(3);
+  json << "{\"traceEvents\":[";
+  auto pid = ::getpid();
+  for (std::size_t k = 0; k < events.size(); k++) {
+    auto& event = events[k];
+    if (k > 0) json << ',';
+    json << "\n{\"name\":";
+    detail::writeJsonString(json, event.name);
+    json << ",\"ph\":\"X\",\"pid\":" << pid << ",\"tid\":" << event.tid
+         << ",\"ts\":" << toUs(event.begin)
+         << ",\"dur\":" << TscClock::toNs(event.end - event.begin) / 1000
+         << ",\"args\":{\"arg\":" << event.arg << "}}";
+  }
+  json << "\n],\"displayTimeUnit\":\"ns\"}\n";
+  out << json.str();
+}
+
+ThreadLocal<detail::TraceBuffer>& Tracer::getBuffers() {
+  // Leaked so threads tracing during static destruction don't use a dead
+  // ThreadLocal.
+  static auto buffers = new ThreadLocal<detail::TraceBuffer>{};
+  return *buffers;
+}
+
+}  // namespace bits
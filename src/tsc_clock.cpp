@@ -0,0 +1,75 @@
+#include <bits/tsc_clock.hpp>
+
+#if defined(__x86_64__)
+#include <cpuid.h>
+#endif
+
+#include <cmath>
+
+namespace bits {
+
+constexpr bool TscClock::is_steady;
+
+namespace {
+
+constexpr auto kCalibrationTime = std::chrono::milliseconds{10};
+
+// Passes which disagree by more than this are considered unreliable.
+constexpr double kCalibrationTolerance = 0.01;
+
+std::int64_t steadyNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+// Returns ticks per ns over kCalibrationTime. Spins rather than sleeps so the
+// cpu stays out of deep c-states.
+double measureTickRate() {
+  auto ns0 = steadyNs();
+  auto ticks0 = TscClock::readTicks();
+  auto deadline = std::chrono::steady_clock::now() + kCalibrationTime;
+  while (std::chrono::steady_clock::now() < deadline) {
+  }
+  auto ticks1 = TscClock::readTicks();
+  auto ns1 = steadyNs();
+  return static_cast<double>(ticks1 - ticks0) / static_cast<double>(ns1 - ns0);
+}
+
+TscCalibration calibrate() {
+  TscCalibration calibration;
+  auto rate1 = measureTickRate();
+  auto rate2 = measureTickRate();
+  calibration.ticksPerNs = (rate1 + rate2) / 2;
+  calibration.nsPerTick = 1 / calibration.ticksPerNs;
+  calibration.reliable =
+      TscClock::isInvariant() && rate1 > 0 && rate2 > 0 &&
+      std::abs(rate1 - rate2) / calibration.ticksPerNs < kCalibrationTolerance;
+  calibration.ns0 = steadyNs();
+  calibration.tick0 = TscClock::readTicks();
+  return calibration;
+}
+
+}  // namespace
+
+bool TscClock::isInvariant() {
+#if defined(__x86_64__)
+  // CPUID.80000007H:EDX[8] is the invariant TSC bit. Linux reports it as the
+  // nonstop_tsc flag in /proc/cpuinfo.
+  unsigned eax, ebx, ecx, edx;
+  if (!__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx)) return false;
+  return edx & (1u << 8);
+#elif defined(__aarch64__)
+  // The generic timer ticks at a constant (system wide) rate by definition.
+  return true;
+#else
+  return false;
+#endif
+}
+
+const TscCalibration& TscClock::getCalibration() {
+  static const auto kCalibration = calibrate();
+  return kCalibration;
+}
+
+}  // namespace bits
@@ -0,0 +1,221 @@
+#include <bits/work_stealing.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <thread>
+
+#include <bits/affinity.hpp>
+
+namespace bits {
+namespace {
+
+// Idle workers yield this many times before going to sleep.
+constexpr std::size_t kSpins = 64;
+
+// Sleeping workers wake up periodically in case they missed a notification.
+// This avoids a (slow) handshake between spawning threads and workers going
+// to sleep at the same time: a push which checks for sleepers just before a
+// worker goes to sleep doesn't wake it.
+constexpr auto kSleep = std::chrono::milliseconds{1};
+
+}  // namespace
+
+namespace detail {
+
+struct Worker {
+  // The deque has cache line padded members which plain new(...) doesn't align
+  // in C++14.
+  static void* operator new(std::size_t size) {
+    return CacheAlignedAllocator<char>{}.allocate(size);
+  }
+
+  static void operator delete(void* p, std::size_t size) {
+    CacheAlignedAllocator<char>{}.deallocate(static_cast<char*>(p), size);
+  }
+
+  WorkStealingPool* pool;
+  detail::ChaseLevDeque<detail::Task*> deque;
+
+  // Other workers ordered by how close they are to this one.
+  std::vector<Worker*> victims;
+
+  std::thread thread;
+};
+
+}  // namespace detail
+
+namespace {
+
+thread_local detail::Worker* tlsWorker = nullptr;
+
+}  // namespace
+
+WorkStealingPool::WorkStealingPool(std::size_t numOfThreads,
+                                   Placement placement,
+                                   const CpuTopology& topology) {
+  auto cpus = placeThreads(topology, placement, numOfThreads);
+  std::map<std::size_t, CpuInfo> infos;
+  for (const auto& info : topology.cpus()) infos[info.cpu] = info;
+
+  // 0 = same core, 1 = same package, 2 = other package. Unpinned workers are
+  // all equally close.
+  auto distance = [&cpus, &infos](std::size_t lhs, std::size_t rhs) {
+    if (cpus.empty()) return 0;
+    const auto& l = infos[cpus[lhs]];
+    const auto& r = infos[cpus[rhs]];
+    if (l.core == r.core) return 0;
+    if (l.package == r.package) return 1;
+    return 2;
+  };
+
+  for (std::size_t k = 0; k < numOfThreads; k++) {
+    workers_.emplace_back(new detail::Worker);
+    workers_.back()->pool = this;
+  }
+
+  // Ties are broken round robin starting after the worker itself so workers
+  // don't all go after the same victim first.
+  auto n = numOfThreads;
+  for (std::size_t k = 0; k < n; k++) {
+    std::vector<std::size_t> others;
+    for (std::size_t j = 1; j < n; j++) others.push_back((k + j) % n);
+    std::stable_sort(others.begin(), others.end(),
+                     [&distance, k](std::size_t lhs, std::size_t rhs) {
+                       return distance(k, lhs) < distance(k, rhs);
+                     });
+    for (auto j : others) workers_[k]->victims.push_back(workers_[j].get());
+  }
+
+  try {
+    for (std::size_t k = 0; k < n; k++) {
+      auto worker = workers_[k].get();
+      worker->thread = std::thread{[this, worker]() { run(worker); }};
+      if (!cpus.empty()) pinThread(worker->thread, cpus[k]);
+    }
+  } catch (...) {
+    // The destructor doesn't run if the constructor throws.
+    stop();
+    throw;
+  }
+}
+
+WorkStealingPool::~WorkStealingPool() { stop(); }
+
+bool WorkStealingPool::tryRunOne() {
+  auto self = tlsWorker && tlsWorker->pool == this ? tlsWorker : nullptr;
+  auto task = findTask(self);
+  if (!task) return false;
+  task->run();
+  delete task;
+  return true;
+}
+
+void WorkStealingPool::stop() {
+  {
+    std::lock_guard<std::mutex> lock{mutex_};
+    stopped_ = true;
+  }
+  cv_.notify_all();
+  for (auto& worker : workers_) {
+    if (worker->thread.joinable()) worker->thread.join();
+  }
+
+  // Only left over if a constructor failed to start all workers.
+  while (auto task = findTask(nullptr)) delete task;
+}
+
+void WorkStealingPool::push(detail::Task* task) {
+  auto own = tlsWorker && tlsWorker->pool == this;
+  if (own) {
+    tlsWorker->deque.push(task);
+    if (numOfSleepers_.load() == 0) return;
+  }
+  {
+    std::lock_guard<std::mutex> lock{mutex_};
+    if (!own) {
+      injected_.push_back(task);
+      numOfInjected_.fetch_add(1);
+    }
+    // Under the mutex so a worker can't check the epoch and go to sleep in
+    // between the bump and the notification.
+    epoch_.fetch_add(1, std::memory_order_release);
+  }
+  if (numOfSleepers_.load() > 0) cv_.notify_one();
+}
+
+detail::Task* WorkStealingPool::findTask(detail::Worker* self) {
+  detail::Task* task;
+  if (self && self->deque.pop(task)) return task;
+
+  if (numOfInjected_.load() > 0) {
+    std::lock_guard<std::mutex> lock{mutex_};
+    if (!injected_.empty()) {
+      task = injected_.front();
+      injected_.pop_front();
+      numOfInjected_.fetch_sub(1);
+      return task;
+    }
+  }
+
+  if (self) {
+    for (auto victim : self->victims) {
+      if (victim->deque.steal(task)) return task;
+    }
+    return nullptr;
+  }
+
+  // Other threads have no position in the topology, they go round robin.
+  auto n = workers_.size();
+  auto first = nextVictim_.fetch_add(1, std::memory_order_relaxed);
+  for (std::size_t k = 0; k < n; k++) {
+    if (workers_[(first + k) % n]->deque.steal(task)) return task;
+  }
+  return nullptr;
+}
+
+void WorkStealingPool::run(detail::Worker* self) {
+  tlsWorker = self;
+
+  std::size_t idle = 0;
+  while (true) {
+    // Read before looking for tasks: tasks pushed after the search bump the
+    // epoch which keeps this worker from sleeping through them. Tasks pushed
+    // to deques aren't visible to the sleep predicate otherwise.
+    auto epoch = epoch_.load(std::memory_order_acquire);
+    if (auto task = findTask(self)) {
+      task->run();
+      delete task;
+      idle = 0;
+      continue;
+    }
+
+    if (++idle < kSpins) {
+      std::this_thread::yield();
+      continue;
+    }
+
+    std::unique_lock<std::mutex> lock{mutex_};
+    if (stopped_) return;
+    numOfSleepers_.fetch_add(1);
+    cv_.wait_for(lock, kSleep, [this, epoch]() {
+      return stopped_ || epoch_.load(std::memory_order_relaxed) != epoch;
+    });
+    numOfSleepers_.fetch_sub(1);
+  }
+}
+
+void TaskGroup::wait() {
+  while (pending_.load(std::memory_order_acquire) > 0) {
+    if (!pool_.tryRunOne()) std::this_thread::yield();
+  }
+
+  std::lock_guard<std::mutex> lock{mutex_};
+  if (exception_) {
+    auto exception = exception_;
+    exception_ = nullptr;
+    std::rethrow_exception(exception);
+  }
+}
+
+}  // namespace bits
@@ -0,0 +1,41 @@
+#include <sched.h>
+
+#include <thread>
+
+#include <gtest/gtest.h>
+
+#include <bits/affinity.hpp>
+
+namespace bits {
+
+TEST(AffinityTest, GetAllowedCpus) {
+  auto cpus = getAllowedCpus();
+  ASSERT_FALSE(cpus.empty());
+  ASSERT_LE(cpus.size(), std::thread::hardware_concurrency());
+}
+
+TEST(AffinityTest, PinThisThread) {
+  for (auto cpu : getAllowedCpus()) {
+    std::thread thread{[cpu]() {
+      pinThisThread(cpu);
+      ASSERT_EQ(::sched_getcpu(), cpu);
+    }};
+    thread.join();
+  }
+}
+
+TEST(AffinityTest, PinThread) {
+  auto cpu = getAllowedCpus().back();
+  std::atomic<bool> pinned{false};
+  std::thread thread{[cpu, &pinned]() {
+    while (!pinned) {
+    }
+    std::this_thread::yield();
+    ASSERT_EQ(::sched_getcpu(), cpu);
+  }};
+  pinThread(thread, cpu);
+  pinned = true;
+  thread.join();
+}
+
+}  // namespace bits
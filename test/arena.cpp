@@ -0,0 +1,101 @@
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <bits/arena.hpp>
+
+namespace bits {
+
+TEST(ArenaTest, Allocate) {
+  Arena arena;
+  auto p = static_cast<char*>(arena.allocate(10));
+  auto q = static_cast<char*>(arena.allocate(10));
+  ASSERT_NE(p, nullptr);
+  ASSERT_GE(q, p + 10);
+  ASSERT_EQ(arena.capacity(), Arena::kDefaultBlockSize);
+}
+
+TEST(ArenaTest, Alignment) {
+  Arena arena;
+  for (std::size_t alignment : {1, 8, 64, 128, 4096}) {
+    arena.allocate(1, 1);
+    auto p = arena.allocate(1, alignment);
+    ASSERT_EQ(reinterpret_cast<std::uintptr_t>(p) % alignment, 0);
+  }
+}
+
+TEST(ArenaTest, Create) {
+  struct Point {
+    Point(int x, int y) : x{x}, y{y} {}
+    int x;
+    int y;
+  };
+
+  Arena arena;
+  auto p = arena.create<Point>(1, 2);
+  ASSERT_EQ(p->x, 1);
+  ASSERT_EQ(p->y, 2);
+}
+
+TEST(ArenaTest, Blocks) {
+  constexpr std::size_t kBlockSize = 64 * 1024;
+
+  Arena arena{kBlockSize};
+  std::vector<char*> ps;
+  for (int k = 0; k < 100; k++) {
+    ps.push_back(static_cast<char*>(arena.allocate(kBlockSize / 10)));
+    std::memset(ps.back(), k, kBlockSize / 10);
+  }
+  for (int k = 0; k < 100; k++) ASSERT_EQ(ps[k][0], static_cast<char>(k));
+  auto capacity = arena.capacity();
+  ASSERT_GE(capacity, 10 * kBlockSize);
+
+  // Blocks are reused after a reset.
+  arena.reset();
+  ASSERT_EQ(arena.allocate(kBlockSize / 10), ps[0]);
+  for (int k = 0; k < 100; k++) arena.allocate(kBlockSize / 10);
+  ASSERT_EQ(arena.capacity(), capacity);
+}
+
+TEST(ArenaTest, Oversized) {
+  constexpr std::size_t kBlockSize = 64 * 1024;
+
+  Arena arena{kBlockSize};
+  auto p = static_cast<char*>(arena.allocate(10 * kBlockSize));
+  std::memset(p, 'x', 10 * kBlockSize);
+  ASSERT_GE(arena.capacity(), 10 * kBlockSize);
+}
+
+TEST(ArenaTest, ZeroSize) {
+  constexpr std::size_t kBlockSize = 64 * 1024;
+
+  // Fill the first block exactly.
+  Arena arena{kBlockSize};
+  auto p = static_cast<char*>(arena.allocate(1, 1));
+  arena.allocate(kBlockSize - 1, 1);
+  auto q = static_cast<char*>(arena.allocate(0, 1));
+  ASSERT_EQ(q, p + kBlockSize);
+  arena.allocate(0, 64);
+  ASSERT_EQ(arena.capacity(), kBlockSize);
+}
+
+TEST(ArenaTest, HugePages) {
+  Arena arena{1, PageBacking::kTransparent};
+  arena.allocate(1);
+  ASSERT_EQ(arena.capacity(), getHugePageSize());
+}
+
+TEST(ArenaAllocatorTest, Map) {
+  using Alloc = ArenaAllocator<std::pair<const int, int>>;
+
+  Arena arena;
+  std::map<int, int, std::less<int>, Alloc> m{Alloc{arena}};
+  for (int k = 0; k < 1'000; k++) m[k] = k * k;
+  for (int k = 0; k < 1'000; k++) ASSERT_EQ(m[k], k * k);
+  ASSERT_EQ(ArenaAllocator<int>{arena}, m.get_allocator());
+}
+
+}  // namespace bits
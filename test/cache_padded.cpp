@@ -0,0 +1,87 @@
+#include <atomic>
+#include <cstdint>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <bits/cache_padded.hpp>
+
+namespace bits {
+
+namespace {
+
+bool isCacheAligned(const void* p) {
+  return reinterpret_cast<std::uintptr_t>(p) % kCacheLinePad == 0;
+}
+
+}  // namespace
+
+TEST(CachePaddedTest, SizeOf) {
+  static_assert(sizeof(CachePadded<char>) == kCacheLinePad, "");
+  static_assert(alignof(CachePadded<char>) == kCacheLinePad, "");
+  static_assert(sizeof(CachePadded<char[kCacheLinePad + 1]>) ==
+                    2 * kCacheLinePad,
+                "");
+}
+
+TEST(CachePaddedTest, Access) {
+  CachePadded<std::vector<int>> xs{3, 7};
+  ASSERT_EQ(xs->size(), 3);
+  ASSERT_EQ((*xs)[0], 7);
+  xs.get().push_back(1);
+  ASSERT_EQ(xs->size(), 4);
+}
+
+TEST(CachePaddedTest, Copy) {
+  CachePadded<std::vector<int>> xs{3, 7};
+  CachePadded<std::vector<int>> ys{xs};
+  ASSERT_EQ(ys->size(), 3);
+  ASSERT_EQ((*ys)[0], 7);
+  CachePadded<std::vector<int>> zs{std::move(ys)};
+  ASSERT_EQ(zs->size(), 3);
+}
+
+TEST(CacheAlignedAllocatorTest, Vector) {
+  std::vector<CachePadded<int>, CacheAlignedAllocator<CachePadded<int>>> xs;
+  for (int k = 0; k < 100; k++) {
+    xs.emplace_back(k);
+    ASSERT_TRUE(isCacheAligned(xs.data()));
+  }
+  for (const auto& x : xs) ASSERT_TRUE(isCacheAligned(&x));
+}
+
+TEST(CachePaddedSlotsTest, Local) {
+  CachePaddedSlots<std::atomic<std::uint64_t>> slots;
+  ASSERT_EQ(slots.size(), CachePaddedSlots<int>::numOfShards());
+  ASSERT_EQ(&slots.local(), &slots.local());
+  ASSERT_EQ(&slots.local(), &slots[CachePaddedSlots<int>::shardOfThread()]);
+
+  std::set<std::uint64_t> addrs;
+  for (std::size_t shard = 0; shard < slots.size(); shard++) {
+    ASSERT_EQ(slots[shard].load(), 0);
+    ASSERT_TRUE(isCacheAligned(&slots[shard]));
+    addrs.insert(reinterpret_cast<std::uintptr_t>(&slots[shard]));
+  }
+  ASSERT_EQ(addrs.size(), slots.size());
+}
+
+TEST(CachePaddedSlotsTest, Sum) {
+  CachePaddedSlots<std::atomic<std::uint64_t>> slots;
+
+  std::vector<std::thread> threads;
+  for (int k = 0; k < 4; k++) {
+    threads.emplace_back([&slots]() {
+      for (int n = 0; n < 1000; n++) slots.local().fetch_add(1);
+    });
+  }
+  for (auto& thread : threads) thread.join();
+
+  std::uint64_t sum = 0;
+  for (std::size_t shard = 0; shard < slots.size(); shard++)
+    sum += slots[shard].load();
+  ASSERT_EQ(sum, 4000);
+}
+
+}  // namespace bits
@@ -0,0 +1,69 @@
+#include <stdexcept>
+
+#include <gtest/gtest.h>
+
+#include <bits/affinity.hpp>
+#include <bits/core_latency.hpp>
+
+namespace bits {
+
+TEST(CoreLatencyTest, MeasureCoreLatencies) {
+  auto cpus = getAllowedCpus();
+  if (cpus.size() > 4) cpus.resize(4);
+
+  auto latencies = measureCoreLatencies(cpus);
+  ASSERT_EQ(latencies.cpus, cpus);
+  ASSERT_EQ(latencies.ns.size(), cpus.size());
+  for (std::size_t i = 0; i < cpus.size(); i++) {
+    ASSERT_EQ(latencies.ns[i].size(), cpus.size());
+    ASSERT_EQ(latencies.ns[i][i], 0);
+    for (std::size_t j = 0; j < cpus.size(); j++) {
+      if (i != j) {
+        ASSERT_GT(latencies.ns[i][j], 0);
+      }
+      ASSERT_EQ(latencies.ns[i][j], latencies.ns[j][i]);
+    }
+  }
+}
+
+TEST(CoreLatencyTest, PinFailure) {
+  // The last cpu of a cpu_set_t, which no machine running the tests has.
+  constexpr std::size_t kNoSuchCpu = 1023;
+  auto cpu = getAllowedCpus().front();
+  ASSERT_THROW(measureCoreLatency(cpu, kNoSuchCpu), std::runtime_error);
+  ASSERT_THROW(measureCoreLatency(kNoSuchCpu, cpu), std::runtime_error);
+}
+
+TEST(CoreLatencyTest, GetLatencyDomains) {
+  // Two sockets with 2 cores each and 2 SMT siblings per core.
+  CoreLatencies latencies{{0, 1, 2, 3, 4, 5, 6, 7}, {}};
+  latencies.ns.assign(8, std::vector<double>(8, 0));
+  for (std::size_t i = 0; i < 8; i++) {
+    for (std::size_t j = 0; j < 8; j++) {
+      if (i == j) continue;
+      if (i / 2 == j / 2) {
+        latencies.ns[i][j] = 20;
+      } else if (i / 4 == j / 4) {
+        latencies.ns[i][j] = 60;
+      } else {
+        latencies.ns[i][j] = 200;
+      }
+    }
+  }
+
+  using Domains = std::vector<std::vector<std::size_t>>;
+  ASSERT_EQ(getLatencyDomains(latencies),
+            (Domains{{0, 1}, {2, 3}, {4, 5}, {6, 7}}));
+  ASSERT_EQ(getLatencyDomains(latencies, 4),
+            (Domains{{0, 1, 2, 3}, {4, 5, 6, 7}}));
+  ASSERT_EQ(getLatencyDomains(latencies, 20),
+            (Domains{{0, 1, 2, 3, 4, 5, 6, 7}}));
+}
+
+TEST(CoreLatencyTest, GetLatencyDomainsSingleCpu) {
+  CoreLatencies latencies{{3}, {{0}}};
+  ASSERT_EQ(getLatencyDomains(latencies),
+            (std::vector<std::vector<std::size_t>>{{3}}));
+}
+
+}  // namespace bits
@@ -0,0 +1,73 @@
+#include <gtest/gtest.h>
+
+#include <stdexcept>
+
+#include <bits/affinity.hpp>
+#include <bits/cpu_topology.hpp>
+
+namespace bits {
+namespace {
+
+using Groups = CpuTopology::Groups;
+
+// Two packages (and nodes) with 2 cores each and 2 SMT siblings per core. The
+// siblings are numbered like Linux does on Intel: cpu k and k + 4.
+CpuTopology makeTopology() {
+  std::vector<CpuInfo> cpus;
+  for (std::size_t cpu = 0; cpu < 8; cpu++) {
+    auto core = cpu % 4;
+    cpus.push_back(CpuInfo{cpu, core, core / 2, core / 2});
+  }
+  return CpuTopology{cpus};
+}
+
+}  // namespace
+
+TEST(CpuTopologyTest, Groups) {
+  auto topology = makeTopology();
+  ASSERT_EQ(topology.cpus().size(), 8);
+  ASSERT_EQ(topology.packages(), (Groups{{0, 1, 4, 5}, {2, 3, 6, 7}}));
+  ASSERT_EQ(topology.cores(), (Groups{{0, 4}, {1, 5}, {2, 6}, {3, 7}}));
+  ASSERT_EQ(topology.nodes(), (Groups{{0, 1, 4, 5}, {2, 3, 6, 7}}));
+}
+
+TEST(CpuTopologyTest, Siblings) {
+  auto topology = makeTopology();
+  ASSERT_EQ(topology.siblings(0), (std::vector<std::size_t>{4}));
+  ASSERT_EQ(topology.siblings(7), (std::vector<std::size_t>{3}));
+  ASSERT_TRUE(topology.siblings(8).empty());
+}
+
+TEST(CpuTopologyTest, Read) {
+  auto topology = CpuTopology::read();
+  std::vector<std::size_t> cpus;
+  for (const auto& info : topology.cpus()) cpus.push_back(info.cpu);
+  ASSERT_EQ(cpus, getAllowedCpus());
+
+  // Every cpu is in exactly one core, package and node.
+  for (const auto& groups :
+       {topology.cores(), topology.packages(), topology.nodes()}) {
+    std::size_t n = 0;
+    for (const auto& group : groups) n += group.size();
+    ASSERT_EQ(n, cpus.size());
+  }
+}
+
+TEST(CpuTopologyTest, Probe) {
+  auto topology = CpuTopology::probe();
+  ASSERT_EQ(topology.cpus().size(), getAllowedCpus().size());
+  ASSERT_LE(topology.cores().size(), topology.cpus().size());
+}
+
+TEST(CpuTopologyTest, ParseCpuList) {
+  using Cpus = std::vector<std::size_t>;
+  ASSERT_EQ(parseCpuList(""), Cpus{});
+  ASSERT_EQ(parseCpuList("3"), Cpus{3});
+  ASSERT_EQ(parseCpuList("0-3,8,10-11"), (Cpus{0, 1, 2, 3, 8, 10, 11}));
+  ASSERT_THROW(parseCpuList("a"), std::invalid_argument);
+  ASSERT_THROW(parseCpuList("3-1"), std::invalid_argument);
+  ASSERT_THROW(parseCpuList("1-"), std::invalid_argument);
+  ASSERT_THROW(parseCpuList("1x"), std::invalid_argument);
+}
+
+}  // namespace bits
@@ -0,0 +1,48 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <bits/flat_combining.hpp>
+
+namespace bits {
+
+TEST(FlatCombiningTest, Apply) {
+  FlatCombining<std::vector<int>> fc{3, 7};
+  fc.apply([](std::vector<int>& v) { v.push_back(8); });
+  ASSERT_EQ(fc.apply([](std::vector<int>& v) { return v; }),
+            (std::vector<int>{7, 7, 7, 8}));
+}
+
+TEST(FlatCombiningTest, Exception) {
+  FlatCombining<int> fc{0};
+  ASSERT_THROW(fc.apply([](int&) -> int { throw std::runtime_error{"x"}; }),
+               std::runtime_error);
+  ASSERT_EQ(fc.apply([](int& x) { return ++x; }), 1);
+}
+
+TEST(FlatCombiningTest, Concurrent) {
+  constexpr int kThreads = 8;
+  constexpr int kIncrements = 10'000;
+
+  FlatCombining<std::uint64_t> fc{0};
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kThreads; t++) {
+    threads.emplace_back([&fc]() {
+      std::uint64_t prev = 0;
+      for (int k = 0; k < kIncrements; k++) {
+        auto curr = fc.apply([](std::uint64_t& x) { return ++x; });
+        ASSERT_GT(curr, prev);
+        prev = curr;
+      }
+    });
+  }
+  for (auto& thread : threads) thread.join();
+
+  ASSERT_EQ(fc.apply([](std::uint64_t& x) { return x; }),
+            kThreads * kIncrements);
+}
+
+}  // namespace bits
@@ -0,0 +1,152 @@
+#include <gtest/gtest.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <set>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <bits/object_pool.hpp>
+#include <bits/rcu.hpp>
+
+namespace bits {
+
+namespace {
+
+struct Object {
+  explicit Object(std::uint64_t x) : x{x} { live++; }
+  ~Object() { live--; }
+
+  std::uint64_t x;
+  static int live;
+};
+
+int Object::live = 0;
+
+struct Throws {
+  Throws() { throw std::runtime_error{"Throws"}; }
+};
+
+struct alignas(64) Aligned {
+  char c;
+};
+
+// Aligned beyond kCacheLinePad.
+struct alignas(512) OverAligned {
+  char c;
+};
+
+}  // namespace
+
+TEST(ObjectPoolTest, CreateDestroy) {
+  auto p = ObjectPool<Object>::create(42);
+  ASSERT_EQ(p->x, 42);
+  ASSERT_EQ(Object::live, 1);
+  ObjectPool<Object>::destroy(p);
+  ASSERT_EQ(Object::live, 0);
+  ObjectPool<Object>::destroy(nullptr);
+}
+
+TEST(ObjectPoolTest, Reuse) {
+  auto p = ObjectPool<Object>::create(1);
+  ObjectPool<Object>::destroy(p);
+  auto q = ObjectPool<Object>::create(2);
+  ASSERT_EQ(p, q);
+  ObjectPool<Object>::destroy(q);
+}
+
+TEST(ObjectPoolTest, Unique) {
+  constexpr std::size_t kObjects = 1'000;
+
+  std::vector<Object*> objects;
+  std::set<Object*> unique;
+  for (std::size_t k = 0; k < kObjects; k++) {
+    objects.push_back(ObjectPool<Object>::create(k));
+    unique.insert(objects.back());
+  }
+  ASSERT_EQ(unique.size(), kObjects);
+  for (std::size_t k = 0; k < kObjects; k++) ASSERT_EQ(objects[k]->x, k);
+  for (auto p : objects) ObjectPool<Object>::destroy(p);
+  ASSERT_EQ(Object::live, 0);
+}
+
+TEST(ObjectPoolTest, Alignment) {
+  std::vector<Aligned*> objects;
+  std::vector<OverAligned*> overAligned;
+  for (int k = 0; k < 100; k++) {
+    objects.push_back(ObjectPool<Aligned>::create());
+    overAligned.push_back(ObjectPool<OverAligned>::create());
+  }
+  for (auto p : objects) {
+    ASSERT_EQ(reinterpret_cast<std::uintptr_t>(p) % alignof(Aligned), 0);
+    ObjectPool<Aligned>::destroy(p);
+  }
+  for (auto p : overAligned) {
+    ASSERT_EQ(reinterpret_cast<std::uintptr_t>(p) % alignof(OverAligned), 0);
+    ObjectPool<OverAligned>::destroy(p);
+  }
+}
+
+TEST(ObjectPoolTest, Throws) {
+  ASSERT_THROW(ObjectPool<Throws>::create(), std::runtime_error);
+}
+
+TEST(ObjectPoolTest, Deleter) {
+  {
+    std::unique_ptr<Object, ObjectPool<Object>::Deleter> p{
+        ObjectPool<Object>::create(1)};
+    ASSERT_EQ(Object::live, 1);
+  }
+  ASSERT_EQ(Object::live, 0);
+}
+
+TEST(ObjectPoolTest, CrossThread) {
+  constexpr std::size_t kObjects = 100 * detail::kMagazineSize;
+  struct Tag {};
+  using Pool = ObjectPool<std::uint64_t, Tag>;
+
+  // Objects freed by another thread are reused by this one (via the depot).
+  std::vector<std::uint64_t*> objects;
+  std::set<std::uint64_t*> allocated;
+  for (std::size_t k = 0; k < kObjects; k++) {
+    objects.push_back(Pool::create(k));
+    allocated.insert(objects.back());
+  }
+  std::thread{[&objects]() {
+    for (auto p : objects) Pool::destroy(p);
+  }}.join();
+
+  std::size_t reused = 0;
+  for (std::size_t k = 0; k < kObjects; k++) {
+    auto p = Pool::create(k);
+    reused += allocated.count(p);
+    objects[k] = p;
+  }
+  ASSERT_EQ(reused, kObjects);
+  for (auto p : objects) Pool::destroy(p);
+}
+
+TEST(ObjectPoolTest, RetireOnThreadExit) {
+  constexpr std::size_t kObjects = 2 * detail::kMagazineSize + 1;
+  struct Tag {};
+  using Pool = ObjectPool<std::uint64_t, Tag>;
+
+  // The thread's Cache is constructed by the first batch of retired objects,
+  // after the retired objects themselves, so it is destroyed before the last
+  // object is freed.
+  std::vector<std::uint64_t*> objects;
+  for (std::size_t k = 0; k < kObjects; k++) objects.push_back(Pool::create(k));
+  std::thread{[&objects]() {
+    for (auto p : objects) RcuSnapshot<Tag>::retire(p, Pool::Deleter{});
+  }}.join();
+
+  std::set<std::uint64_t*> allocated;
+  for (std::size_t k = 0; k < 2 * kObjects; k++)
+    allocated.insert(Pool::create(k));
+  ASSERT_EQ(allocated.size(), 2 * kObjects);
+  for (auto p : allocated) Pool::destroy(p);
+}
+
+}  // namespace bits
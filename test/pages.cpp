@@ -0,0 +1,64 @@
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <bits/pages.hpp>
+
+namespace bits {
+
+TEST(PagesTest, PageSizes) {
+  ASSERT_GT(getPageSize(), 0);
+  ASSERT_GT(getHugePageSize(), getPageSize());
+  ASSERT_EQ(getHugePageSize() % getPageSize(), 0);
+}
+
+TEST(PagesTest, MappedSize) {
+  ASSERT_EQ(getMappedSize(0, PageBacking::kRegular), getPageSize());
+  ASSERT_EQ(getMappedSize(1, PageBacking::kRegular), getPageSize());
+  ASSERT_EQ(getMappedSize(getPageSize() + 1, PageBacking::kRegular),
+            2 * getPageSize());
+  ASSERT_EQ(getMappedSize(1, PageBacking::kTransparent), getHugePageSize());
+  ASSERT_EQ(getMappedSize(1, PageBacking::kExplicit), getHugePageSize());
+}
+
+TEST(PagesTest, MapPages) {
+  for (auto backing : {PageBacking::kRegular, PageBacking::kTransparent,
+                       PageBacking::kExplicit}) {
+    auto size = 3 * getHugePageSize() + 1;
+    auto actual = backing;
+    auto p = static_cast<char*>(mapPages(size, backing, &actual));
+    ASSERT_NE(p, nullptr);
+    if (!isPageBackingAvailable(backing)) {
+      ASSERT_NE(actual, backing);
+    }
+    if (actual != PageBacking::kRegular) {
+      ASSERT_EQ(reinterpret_cast<std::uintptr_t>(p) % getHugePageSize(), 0);
+    }
+
+    // Memory should be zeroed and writable.
+    ASSERT_EQ(p[0], 0);
+    ASSERT_EQ(p[size - 1], 0);
+    std::memset(p, 'x', size);
+    unmapPages(p, size, backing);
+  }
+}
+
+TEST(PageAllocatorTest, Vector) {
+  PageAllocator<int> alloc{PageBacking::kTransparent};
+  std::vector<int, PageAllocator<int>> xs{alloc};
+  for (int k = 0; k < 100000; k++) xs.push_back(k);
+  for (int k = 0; k < 100000; k++) ASSERT_EQ(xs[k], k);
+  ASSERT_EQ(xs.get_allocator().backing(), PageBacking::kTransparent);
+}
+
+TEST(PageAllocatorTest, Actual) {
+  auto actual = PageBacking::kExplicit;
+  std::vector<int, PageAllocator<int>> xs{
+      PageAllocator<int>{PageBacking::kRegular, &actual}};
+  xs.reserve(1000);
+  ASSERT_EQ(actual, PageBacking::kRegular);
+}
+
+}  // namespace bits
@@ -0,0 +1,110 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include <bits/mpsc_queue.hpp>
+#include <bits/spsc_queue.hpp>
+
+namespace bits {
+namespace {
+
+constexpr std::uint64_t kN = 200'000;
+constexpr std::uint64_t kProducers = 4;
+constexpr std::uint64_t kBatch = 3;
+
+}  // namespace
+
+template <typename Q>
+class QueueTest : public ::testing::Test {};
+
+using Queues =
+    ::testing::Types<SpscQueue<std::uint64_t>, MpscQueue<std::uint64_t>>;
+TYPED_TEST_CASE(QueueTest, Queues);
+
+TYPED_TEST(QueueTest, PushPop) {
+  TypeParam queue{3};
+  ASSERT_EQ(queue.capacity(), 4);
+
+  std::uint64_t x;
+  ASSERT_FALSE(queue.tryPop(x));
+  for (std::uint64_t k = 0; k < 4; k++) ASSERT_TRUE(queue.tryPush(k));
+  ASSERT_FALSE(queue.tryPush(4));
+
+  for (std::uint64_t k = 0; k < 4; k++) {
+    ASSERT_TRUE(queue.tryPop(x));
+    ASSERT_EQ(x, k);
+  }
+  ASSERT_FALSE(queue.tryPop(x));
+}
+
+TYPED_TEST(QueueTest, Batch) {
+  TypeParam queue{8};
+  std::vector<std::uint64_t> in{0, 1, 2, 3, 4, 5};
+  ASSERT_EQ(queue.tryPushBatch(in.begin(), in.end()), 6);
+  ASSERT_EQ(queue.tryPushBatch(in.begin(), in.end()), 2);
+
+  std::vector<std::uint64_t> out(10);
+  ASSERT_EQ(queue.tryPopBatch(out.begin(), 3), 3);
+  ASSERT_EQ(queue.tryPopBatch(out.begin() + 3, 10), 5);
+  ASSERT_EQ(out, (std::vector<std::uint64_t>{0, 1, 2, 3, 4, 5, 0, 1, 0, 0}));
+  ASSERT_EQ(queue.tryPopBatch(out.begin(), 10), 0);
+}
+
+TEST(SpscQueueTest, Concurrent) {
+  SpscQueue<std::uint64_t> queue{64};
+
+  std::thread producer{[&queue]() {
+    for (std::uint64_t k = 0; k < kN; k++) {
+      while (!queue.tryPush(k)) std::this_thread::yield();
+    }
+  }};
+
+  std::uint64_t x;
+  for (std::uint64_t k = 0; k < kN; k++) {
+    while (!queue.tryPop(x)) std::this_thread::yield();
+    ASSERT_EQ(x, k);
+  }
+  producer.join();
+}
+
+TEST(MpscQueueTest, Concurrent) {
+  MpscQueue<std::uint64_t> queue{64};
+
+  // Each producer pushes its id * kN + k in batches. Items of each producer
+  // must be popped in order.
+  std::vector<std::thread> producers;
+  for (std::uint64_t p = 0; p < kProducers; p++) {
+    producers.emplace_back([&queue, p]() {
+      for (std::uint64_t k = 0; k < kN; k += kBatch) {
+        std::vector<std::uint64_t> items;
+        for (auto i = k; i < std::min(k + kBatch, kN); i++)
+          items.push_back(p * kN + i);
+        auto first = items.begin();
+        while (first < items.end()) {
+          auto n = queue.tryPushBatch(first, items.end());
+          if (n == 0) std::this_thread::yield();
+          first += n;
+        }
+      }
+    });
+  }
+
+  std::vector<std::uint64_t> next(kProducers, 0);
+  std::vector<std::uint64_t> out(16);
+  for (std::uint64_t popped = 0; popped < kN * kProducers;) {
+    auto n = queue.tryPopBatch(out.begin(), out.size());
+    if (n == 0) std::this_thread::yield();
+    for (std::size_t k = 0; k < n; k++) {
+      auto p = out[k] / kN;
+      ASSERT_EQ(out[k] % kN, next[p]);
+      next[p]++;
+    }
+    popped += n;
+  }
+  for (auto& producer : producers) producer.join();
+}
+
+}  // namespace bits
@@ -68,4 +68,34 @@ TEST_F(RcuTest, MoveOp) {
   ASSERT_TRUE(done);
 }
 
+TEST_F(RcuTest, Retire) {
+  RunInThread([this]() {
+    RcuSnapshot<> snap;
+    SleepMs(200);
+    done = true;
+  });
+
+  SleepMs(100);
+  int freed = 0;
+  RcuSnapshot<>::retire(&freed, [this](int* p) {
+    ASSERT_TRUE(done);
+    (*p)++;
+  });
+  RcuSnapshot<>::flush();
+
+  ASSERT_EQ(freed, 1);
+}
+
+TEST_F(RcuTest, RetireBatch) {
+  constexpr int kRetired = 1'000;
+
+  int freed = 0;
+  for (int k = 0; k < kRetired; k++)
+    RcuSnapshot<>::retire(&freed, [](int* p) { (*p)++; });
+  ASSERT_GT(freed, 0);
+  RcuSnapshot<>::flush();
+
+  ASSERT_EQ(freed, kRetired);
+}
+
 }  // namespace bits
@@ -0,0 +1,49 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <bits/spinlock.hpp>
+
+namespace bits {
+
+template <typename L>
+class SpinlockTest : public ::testing::Test {};
+
+using Locks = ::testing::Types<TasLock, TtasLock, TicketLock, McsLock, ClhLock>;
+TYPED_TEST_CASE(SpinlockTest, Locks);
+
+TYPED_TEST(SpinlockTest, MutualExclusion) {
+  constexpr int kThreads = 4;
+  constexpr int kIncrements = 5'000;
+
+  TypeParam lock;
+  std::uint64_t n = 0;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kThreads; t++) {
+    threads.emplace_back([&lock, &n]() {
+      for (int k = 0; k < kIncrements; k++) {
+        std::lock_guard<TypeParam> guard{lock};
+        n++;
+      }
+    });
+  }
+  for (auto& thread : threads) thread.join();
+
+  ASSERT_EQ(n, kThreads * kIncrements);
+}
+
+TYPED_TEST(SpinlockTest, Nested) {
+  TypeParam outer;
+  TypeParam inner;
+  for (int k = 0; k < 100; k++) {
+    outer.lock();
+    inner.lock();
+    outer.unlock();
+    inner.unlock();
+  }
+}
+
+}  // namespace bits
@@ -0,0 +1,133 @@
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <bits/thread_local.hpp>
+
+namespace bits {
+
+namespace {
+
+struct Counter {
+  Counter() { live++; }
+  ~Counter() { live--; }
+
+  std::atomic<std::uint64_t> n{0};
+  static std::atomic<int> live;
+};
+
+std::atomic<int> Counter::live{0};
+
+}  // namespace
+
+TEST(ThreadLocalTest, PerThread) {
+  ThreadLocal<int> tl;
+  *tl = 1;
+  std::thread{[&tl]() {
+    ASSERT_EQ(*tl, 0);
+    *tl = 2;
+    ASSERT_EQ(*tl, 2);
+  }}.join();
+  ASSERT_EQ(*tl, 1);
+}
+
+TEST(ThreadLocalTest, PerObject) {
+  ThreadLocal<int> tl1;
+  ThreadLocal<int> tl2;
+  *tl1 = 1;
+  *tl2 = 2;
+  ASSERT_NE(tl1.get(), tl2.get());
+  ASSERT_EQ(*tl1, 1);
+  ASSERT_EQ(*tl2, 2);
+
+  std::vector<std::unique_ptr<ThreadLocal<int>>> tls;
+  for (int k = 0; k < 100; k++) {
+    tls.emplace_back(new ThreadLocal<int>{});
+    **tls.back() = k;
+  }
+  for (int k = 0; k < 100; k++) ASSERT_EQ(**tls[k], k);
+}
+
+TEST(ThreadLocalTest, Factory) {
+  ThreadLocal<int> tl{[]() { return new int{42}; }};
+  ASSERT_EQ(*tl, 42);
+}
+
+TEST(ThreadLocalTest, DisposeOnThreadExit) {
+  ThreadLocal<Counter> tl;
+  std::thread{[&tl]() {
+    tl->n++;
+    ASSERT_EQ(Counter::live, 1);
+  }}.join();
+  ASSERT_EQ(Counter::live, 0);
+}
+
+TEST(ThreadLocalTest, DisposeOnDestruction) {
+  {
+    ThreadLocal<Counter> tl;
+    tl->n++;
+    ASSERT_EQ(Counter::live, 1);
+  }
+  ASSERT_EQ(Counter::live, 0);
+
+  // A recycled id starts over with a new value.
+  ThreadLocal<Counter> tl;
+  ASSERT_EQ(tl->n, 0);
+}
+
+TEST(ThreadLocalTest, AccessAllThreads) {
+  constexpr int kThreads = 4;
+  constexpr std::uint64_t kIncrements = 1'000;
+
+  ThreadLocal<Counter> tl;
+  std::atomic<int> ready{0};
+  std::atomic<bool> done{false};
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kThreads; t++) {
+    threads.emplace_back([&]() {
+      for (std::uint64_t k = 0; k < kIncrements; k++)
+        tl->n.fetch_add(1, std::memory_order_relaxed);
+      ready++;
+      while (!done) std::this_thread::yield();
+    });
+  }
+  while (ready < kThreads) std::this_thread::yield();
+
+  std::uint64_t sum = 0;
+  std::set<Counter*> counters;
+  for (auto& counter : tl.accessAllThreads()) {
+    sum += counter.n;
+    counters.insert(&counter);
+  }
+  ASSERT_EQ(sum, kThreads * kIncrements);
+  ASSERT_EQ(counters.size(), kThreads);
+
+  done = true;
+  for (auto& thread : threads) thread.join();
+  auto accessor = tl.accessAllThreads();
+  ASSERT_EQ(accessor.begin(), accessor.end());
+}
+
+TEST(ThreadLocalTest, AccessWhileIterating) {
+  ThreadLocal<Counter> tl;
+  ThreadLocal<Counter> other;
+  tl->n = 1;
+
+  // The first ThreadLocal<...> access of the thread registers it, which takes
+  // the lock held by the accessor.
+  std::uint64_t sum = 0;
+  std::thread{[&]() {
+    for (auto& counter : tl.accessAllThreads()) {
+      other->n += counter.n;
+      sum += other->n;
+    }
+  }}.join();
+  ASSERT_EQ(sum, 1);
+}
+
+}  // namespace bits
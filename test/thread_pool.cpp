@@ -0,0 +1,78 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <future>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <bits/affinity.hpp>
+#include <bits/thread_pool.hpp>
+
+namespace bits {
+namespace {
+
+using Cpus = std::vector<std::size_t>;
+
+// Two packages with 2 cores each and 2 SMT siblings per core. The siblings are
+// numbered like Linux does on Intel: cpu k and k + 4.
+CpuTopology makeTopology() {
+  std::vector<CpuInfo> cpus;
+  for (std::size_t cpu = 0; cpu < 8; cpu++) {
+    auto core = cpu % 4;
+    cpus.push_back(CpuInfo{cpu, core, core / 2, core / 2});
+  }
+  return CpuTopology{cpus};
+}
+
+}  // namespace
+
+TEST(ThreadPoolTest, PlaceThreads) {
+  auto topology = makeTopology();
+  ASSERT_EQ(placeThreads(topology, Placement::kNone, 4), Cpus{});
+  ASSERT_EQ(placeThreads(topology, Placement::kPhysicalCores, 6),
+            (Cpus{0, 1, 2, 3, 0, 1}));
+  ASSERT_EQ(placeThreads(topology, Placement::kCompact, 8),
+            (Cpus{0, 4, 1, 5, 2, 6, 3, 7}));
+  ASSERT_EQ(placeThreads(topology, Placement::kScatter, 8),
+            (Cpus{0, 2, 1, 3, 4, 6, 5, 7}));
+}
+
+TEST(ThreadPoolTest, Submit) {
+  ThreadPool pool{4};
+  ASSERT_EQ(pool.size(), 4);
+  ASSERT_TRUE(pool.cpus().empty());
+
+  std::atomic<int> n{0};
+  std::vector<std::future<int>> futures;
+  for (int k = 0; k < 100; k++) {
+    futures.push_back(pool.submit([&n, k]() {
+      n++;
+      return k;
+    }));
+  }
+  for (int k = 0; k < 100; k++) ASSERT_EQ(futures[k].get(), k);
+  ASSERT_EQ(n.load(), 100);
+
+  auto error = pool.submit([]() { throw std::runtime_error{"error"}; });
+  ASSERT_THROW(error.get(), std::runtime_error);
+}
+
+TEST(ThreadPoolTest, Pinned) {
+  auto cpus = getAllowedCpus();
+  ThreadPool pool{2, Placement::kPhysicalCores};
+  ASSERT_EQ(pool.cpus().size(), 2);
+  ASSERT_EQ(pool.cpus().front(), cpus.front());
+  ASSERT_EQ(pool.submit([]() { return 1; }).get(), 1);
+}
+
+TEST(ThreadPoolTest, DestructorRunsRemainingTasks) {
+  std::atomic<int> n{0};
+  {
+    ThreadPool pool{Cpus{getAllowedCpus().front()}};
+    for (int k = 0; k < 10; k++) pool.submit([&n]() { n++; });
+  }
+  ASSERT_EQ(n.load(), 10);
+}
+
+}  // namespace bits
@@ -0,0 +1,18 @@
+#include <gtest/gtest.h>
+
+#include <bits/tlb.hpp>
+
+namespace bits {
+
+TEST(TlbTest, GetTlbReach) {
+  auto reach = getTlbReach();
+  ASSERT_TRUE(reach);
+  ASSERT_GT(reach->pageSize, 0);
+  ASSERT_GT(reach->l1Entries, 0);
+  ASSERT_EQ(reach->l1Reach(), reach->l1Entries * reach->pageSize);
+  if (reach->l2Entries) {
+    ASSERT_GT(*reach->l2Entries, reach->l1Entries);
+  }
+}
+
+}  // namespace bits
@@ -0,0 +1,109 @@
+#include <atomic>
+#include <cstddef>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <bits/trace.hpp>
+
+namespace bits {
+
+namespace {
+
+std::size_t count(const std::string& s, const std::string& needle) {
+  std::size_t n = 0;
+  for (auto p = s.find(needle); p != std::string::npos;
+       p = s.find(needle, p + 1)) {
+    n++;
+  }
+  return n;
+}
+
+std::string dump() {
+  std::ostringstream out;
+  Tracer::dump(out);
+  return out.str();
+}
+
+}  // namespace
+
+TEST(TraceTest, Dump) {
+  Tracer::instant("trace.test.instant", 42);
+  { TraceScope scope{"trace.test.scope"}; }
+
+  auto json = dump();
+  ASSERT_EQ(json.find("{\"traceEvents\":["), 0);
+  ASSERT_NE(json.find("\"name\":\"trace.test.instant\",\"ph\":\"X\""),
+            std::string::npos);
+  ASSERT_NE(json.find("\"args\":{\"arg\":42}"), std::string::npos);
+  ASSERT_EQ(count(json, "\"name\":\"trace.test.scope\""), 1);
+}
+
+TEST(TraceTest, Ordered) {
+  auto begin = Tracer::now();
+  Tracer::record("trace.test.second", begin + 2, begin + 3);
+  Tracer::record("trace.test.first", begin + 1, begin + 2);
+
+  auto json = dump();
+  ASSERT_LT(json.find("trace.test.first"), json.find("trace.test.second"));
+}
+
+TEST(TraceTest, Wraparound) {
+  for (std::size_t k = 0; k < kTraceBufferSize + 10; k++)
+    Tracer::instant("trace.test.wrap", k);
+
+  // Only the most recent events are kept.
+  auto json = dump();
+  ASSERT_EQ(count(json, "\"name\":\"trace.test.wrap\""),
+            kTraceBufferSize - 1);
+  ASSERT_EQ(count(json, "\"args\":{\"arg\":10}"), 0);
+  ASSERT_EQ(count(json, "\"args\":{\"arg\":11}"), 1);
+}
+
+TEST(TraceTest, Threads) {
+  constexpr std::size_t kThreads = 4;
+  constexpr std::size_t kEvents = 100;
+
+  std::atomic<std::size_t> recorded{0};
+  std::atomic<bool> dumped{false};
+  std::vector<std::thread> threads;
+  for (std::size_t k = 0; k < kThreads; k++) {
+    threads.emplace_back([&recorded, &dumped]() {
+      for (std::size_t e = 0; e < kEvents; e++)
+        Tracer::instant("trace.test.threads");
+      recorded++;
+      // Events of exited threads are lost so wait for the dump.
+      while (!dumped.load()) std::this_thread::yield();
+    });
+  }
+
+  while (recorded.load() < kThreads) std::this_thread::yield();
+  auto json = dump();
+  dumped = true;
+  for (auto& thread : threads) thread.join();
+
+  ASSERT_EQ(count(json, "\"name\":\"trace.test.threads\""),
+            kThreads * kEvents);
+}
+
+TEST(TraceTest, ConcurrentDump) {
+  std::atomic<bool> done{false};
+  std::thread writer{[&done]() {
+    while (!done.load()) Tracer::instant("trace.test.concurrent");
+  }};
+
+  for (auto k = 0; k < 10; k++) {
+    auto json = dump();
+    ASSERT_LE(count(json, "\"name\":\"trace.test.concurrent\""),
+              kTraceBufferSize);
+    std::this_thread::yield();
+  }
+
+  done = true;
+  writer.join();
+}
+
+}  // namespace bits
@@ -0,0 +1,64 @@
+#include <chrono>
+#include <cstdint>
+#include <thread>
+
+#include <gtest/gtest.h>
+
+#include <bits/tsc_clock.hpp>
+
+namespace bits {
+
+TEST(TscClockTest, Monotonic) {
+  // Raw ticks are only monotonic if the counter is synchronized across cpus,
+  // now() falls back to steady_clock otherwise.
+  auto reliable = TscClock::getCalibration().reliable;
+  auto prev = TscClock::now();
+  auto prevTicks = TscClock::readTicks();
+  for (auto k = 0; k < 100'000; k++) {
+    auto now = TscClock::now();
+    auto ticks = TscClock::readTicks();
+    ASSERT_GE(now, prev);
+    if (reliable) {
+      ASSERT_GE(ticks, prevTicks);
+    }
+    prev = now;
+    prevTicks = ticks;
+  }
+}
+
+TEST(TscClockTest, Calibration) {
+  auto& calibration = TscClock::getCalibration();
+  ASSERT_GT(calibration.ticksPerNs, 0);
+  ASSERT_DOUBLE_EQ(calibration.ticksPerNs * calibration.nsPerTick, 1);
+  if (!TscClock::isInvariant()) {
+    ASSERT_FALSE(calibration.reliable);
+  }
+}
+
+TEST(TscClockTest, TracksSteadyClock) {
+  auto steadyBegin = std::chrono::steady_clock::now();
+  auto begin = TscClock::now();
+  auto ticksBegin = TscClock::readTicks();
+  std::this_thread::sleep_for(std::chrono::milliseconds{50});
+  auto ticksEnd = TscClock::readTicks();
+  auto end = TscClock::now();
+  auto steadyEnd = std::chrono::steady_clock::now();
+
+  std::chrono::duration<double, std::nano> steady = steadyEnd - steadyBegin;
+  std::chrono::duration<double, std::nano> tsc = end - begin;
+  ASSERT_NEAR(tsc.count(), steady.count(), steady.count() * 0.05);
+  // Raw ticks only track steady_clock with an invariant, synchronized counter.
+  if (TscClock::getCalibration().reliable) {
+    ASSERT_NEAR(TscClock::toNs(ticksEnd - ticksBegin), steady.count(),
+                steady.count() * 0.05);
+  }
+}
+
+TEST(TscClockTest, AlignedWithSteadyClock) {
+  auto steady = std::chrono::steady_clock::now().time_since_epoch();
+  auto tsc = TscClock::now().time_since_epoch();
+  std::chrono::duration<double, std::milli> offset = tsc - steady;
+  ASSERT_NEAR(offset.count(), 0, 10);
+}
+
+}  // namespace bits
@@ -0,0 +1,112 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <cstdint>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <bits/work_stealing.hpp>
+
+namespace bits {
+namespace {
+
+std::uint64_t fib(WorkStealingPool& pool, std::uint64_t n) {
+  if (n < 2) return n;
+  std::uint64_t lhs;
+  TaskGroup group{pool};
+  group.spawn([&pool, &lhs, n]() { lhs = fib(pool, n - 1); });
+  auto rhs = fib(pool, n - 2);
+  group.wait();
+  return lhs + rhs;
+}
+
+}  // namespace
+
+TEST(ChaseLevDequeTest, PushPopSteal) {
+  detail::ChaseLevDeque<int> deque{2};
+  ASSERT_TRUE(deque.empty());
+  for (int k = 0; k < 10; k++) deque.push(k);
+
+  int x;
+  ASSERT_TRUE(deque.steal(x));
+  ASSERT_EQ(x, 0);
+  ASSERT_TRUE(deque.pop(x));
+  ASSERT_EQ(x, 9);
+  for (int k = 8; k > 0; k--) {
+    ASSERT_TRUE(deque.pop(x));
+    ASSERT_EQ(x, k);
+  }
+  ASSERT_FALSE(deque.pop(x));
+  ASSERT_FALSE(deque.steal(x));
+  ASSERT_TRUE(deque.empty());
+}
+
+TEST(ChaseLevDequeTest, ConcurrentSteal) {
+  constexpr int kN = 100'000;
+  constexpr int kThieves = 3;
+  detail::ChaseLevDeque<int> deque;
+  std::atomic<bool> done{false};
+  std::vector<std::atomic<int>> seen(kN);
+  for (auto& s : seen) s.store(0);
+
+  std::vector<std::thread> thieves;
+  for (int t = 0; t < kThieves; t++) {
+    thieves.emplace_back([&deque, &done, &seen]() {
+      int x;
+      while (!done.load() || !deque.empty()) {
+        if (deque.steal(x)) seen[x]++;
+      }
+    });
+  }
+
+  int x;
+  for (int k = 0; k < kN; k++) {
+    deque.push(k);
+    if (k % 3 == 0 && deque.pop(x)) seen[x]++;
+  }
+  while (deque.pop(x)) seen[x]++;
+  done.store(true);
+  for (auto& thief : thieves) thief.join();
+
+  for (int k = 0; k < kN; k++) ASSERT_EQ(seen[k].load(), 1) << k;
+}
+
+TEST(WorkStealingPoolTest, Fib) {
+  for (std::size_t n : {1, 2, 4}) {
+    WorkStealingPool pool{n};
+    ASSERT_EQ(pool.size(), n);
+    ASSERT_EQ(fib(pool, 20), 6765);
+  }
+}
+
+TEST(WorkStealingPoolTest, Pinned) {
+  WorkStealingPool pool{2, Placement::kCompact};
+  ASSERT_EQ(fib(pool, 15), 610);
+}
+
+TEST(WorkStealingPoolTest, DestructorRunsRemainingTasks) {
+  std::atomic<int> n{0};
+  {
+    WorkStealingPool pool{2};
+    for (int k = 0; k < 100; k++) pool.spawn([&n]() { n++; });
+  }
+  ASSERT_EQ(n.load(), 100);
+}
+
+TEST(TaskGroupTest, Exception) {
+  WorkStealingPool pool{2};
+  TaskGroup group{pool};
+  std::atomic<int> n{0};
+  for (int k = 0; k < 10; k++) {
+    group.spawn([&n, k]() {
+      n++;
+      if (k == 5) throw std::runtime_error{"error"};
+    });
+  }
+  ASSERT_THROW(group.wait(), std::runtime_error);
+  ASSERT_EQ(n.load(), 10);
+  group.wait();
+}
+
+}  // namespace bits